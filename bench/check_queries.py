@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Check queries/*.scm against the node types of the generated grammar.
+
+Every node name, anonymous token and field used in a query must exist in
+src/node-types.json, and a field must be one the enclosing node type has.
+Otherwise ts_query_new rejects the whole file, and every editor or tool that
+loads it gets no highlighting, folding or indentation at all. A named child
+must also be a node type its parent (or that field of it) can hold, or the
+pattern is dead: it compiles but can never match.
+
+bench/query_profile.c does the same against the real runtime and finds the
+patterns that match nothing in the sample corpora.
+
+Usage: check_queries.py [--node-types src/node-types.json] [query.scm ...]
+"""
+import argparse
+import glob
+import json
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+
+TOKEN = re.compile(r"""
+    (?P<comment>;[^\n]*)
+  | (?P<string>"(?:[^"\\]|\\.)*")
+  | (?P<open>\()
+  | (?P<close>\))
+  | (?P<field>[A-Za-z_][\w-]*)\s*:
+  | (?P<negated>![A-Za-z_][\w-]*)
+  | (?P<capture>@[\w.-]+)
+  | (?P<predicate>\#[\w?!-]+)
+  | (?P<name>[A-Za-z_][\w/-]*)
+  | (?P<other>\S)
+""", re.VERBOSE)
+
+
+class NodeTypes:
+    def __init__(self, path):
+        self.named = set()
+        self.anonymous = set()
+        self.fields = {}    # node type -> field -> possible node types
+        self.children = {}  # node type -> possible children outside fields
+        self.subtypes = {}  # supertype -> its subtypes
+        with open(path) as f:
+            for entry in json.load(f):
+                node_type = entry["type"]
+                if not entry["named"]:
+                    self.anonymous.add(node_type)
+                    continue
+                self.named.add(node_type)
+                self.fields[node_type] = {name: {t["type"] for t in field["types"]}
+                                          for name, field in entry.get("fields", {}).items()}
+                self.children[node_type] = {t["type"] for t in entry.get("children", {}).get("types", [])}
+                if "subtypes" in entry:
+                    self.subtypes[node_type] = {t["type"] for t in entry["subtypes"]}
+
+    def has_field(self, field):
+        return any(field in node_fields for node_fields in self.fields.values())
+
+    def expand(self, types):
+        expanded = set()
+        pending = list(types)
+        while pending:
+            node_type = pending.pop()
+            if node_type not in expanded:
+                expanded.add(node_type)
+                pending.extend(self.subtypes.get(node_type, ()))
+        return expanded
+
+    # Node types that can appear as a direct child of parent, in field if given
+    def child_types(self, parent, field):
+        if field:
+            return self.expand(self.fields[parent].get(field, ()))
+        types = set(self.children[parent])
+        for field_types in self.fields[parent].values():
+            types |= field_types
+        return self.expand(types)
+
+
+def line_of(text, offset):
+    return text.count("\n", 0, offset) + 1
+
+
+def check_query(path, node_types):
+    with open(path) as f:
+        text = f.read()
+
+    errors = []
+
+    def error(m, message):
+        errors.append((line_of(text, m.start()), message))
+
+    # One entry per open parenthesis: the node type, "" for a group or a
+    # wildcard, or None for a predicate, whose arguments are not nodes
+    stack = []
+    expect_name = False
+    field = None  # field of the next child node
+    for m in TOKEN.finditer(text):
+        kind = m.lastgroup
+        value = m.group(kind)
+        in_predicate = bool(stack) and stack[-1] is None
+        if kind == "comment":
+            continue
+        if expect_name:
+            expect_name = False
+            if kind == "name":
+                node_type = value.split("/")[-1]
+                parent = stack[-1] if stack else ""
+                if node_type in ("_", "ERROR", "MISSING"):
+                    pass
+                elif node_type not in node_types.named:
+                    error(m, f"unknown node type '{node_type}'")
+                elif parent in node_types.named and node_type not in node_types.child_types(parent, field):
+                    # Structurally impossible: the pattern is dead
+                    where = f"in field '{field}' of" if field else "as a child of"
+                    error(m, f"'{node_type}' never appears {where} '{parent}'")
+                stack.append(node_type)
+                field = None
+                continue
+            if kind == "predicate":
+                stack.append(None)
+                continue
+            stack.append("")
+        if kind == "open":
+            expect_name = True
+        elif kind == "close":
+            if stack:
+                stack.pop()
+            field = None
+        elif in_predicate:
+            continue
+        elif kind == "string":
+            field = None
+            if json.loads(value) not in node_types.anonymous:
+                error(m, f"unknown token {value}")
+        elif kind in ("field", "negated"):
+            name = value.lstrip("!")
+            parent = stack[-1] if stack else ""
+            if not node_types.has_field(name):
+                error(m, f"unknown field '{name}'")
+            elif parent in node_types.named and name not in node_types.fields[parent]:
+                error(m, f"'{parent}' has no field '{name}'")
+            elif kind == "field" and parent in node_types.named:
+                field = name
+        elif kind == "other" and value == "[":
+            # A field before an alternation is not checked per alternative
+            field = None
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--node-types", default=os.path.join(ROOT, "src", "node-types.json"))
+    parser.add_argument("queries", nargs="*")
+    args = parser.parse_args()
+
+    queries = args.queries or sorted(glob.glob(os.path.join(ROOT, "queries", "*.scm")))
+    if not queries:
+        print("ERROR (no query files found)")
+        sys.exit(1)
+    node_types = NodeTypes(args.node_types)
+
+    failed = False
+    for path in queries:
+        errors = check_query(path, node_types)
+        for line, message in errors:
+            print(f"{os.path.relpath(path)}:{line}: {message}")
+        failed = failed or bool(errors)
+    if failed:
+        print("ERROR (queries do not match src/node-types.json)")
+        sys.exit(1)
+    print(f"{len(queries)} query files OK")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 200809L
+
+// GLR fork profiler. Parses each input with a parse logger attached and
+// follows the runtime's "process version:%u, version_count:%u, state:%d"
+// messages. Whenever the number of stack versions grows, the state of the
+// version processed just before is the state whose conflicting actions split
+// the stack. Each fork is then followed until the version count drops back,
+// which gives how long it lived (in processing steps and wall time).
+//
+// The parse table of the language (src/tree_sitter/parser.h) is read to list
+// the conflicting actions of every forking state, so glr_report.py can map
+// them back to the conflicts declared in grammar.js.
+//
+// Usage: glr_profile [--json <output_file>] <file_or_dir>...
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+
+#include "tree_sitter/parser.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+#define MAX_OPEN_FORKS 1024
+
+typedef struct {
+  uint64_t forks;
+  uint64_t steps;
+  double seconds;
+} StateStats;
+
+typedef struct {
+  TSStateId state;
+  uint32_t base_count;
+  uint64_t start_step;
+  double start_time;
+} OpenFork;
+
+typedef struct {
+  StateStats *states;
+  uint32_t state_count;
+  OpenFork open[MAX_OPEN_FORKS];
+  uint32_t open_count;
+  uint64_t step;
+  uint64_t forked_steps;
+  uint32_t last_version_count;
+  int32_t last_state;
+} Profile;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void profile_reset(Profile *profile) {
+  memset(profile->states, 0, profile->state_count * sizeof(StateStats));
+  profile->open_count = 0;
+  profile->step = 0;
+  profile->forked_steps = 0;
+  profile->last_version_count = 1;
+  profile->last_state = -1;
+}
+
+// Close every open fork that started above version_count
+static void profile_close_forks(Profile *profile, uint32_t version_count, double now) {
+  while (profile->open_count > 0 && profile->open[profile->open_count - 1].base_count >= version_count) {
+    OpenFork *fork = &profile->open[--profile->open_count];
+    StateStats *stats = &profile->states[fork->state];
+    stats->steps += profile->step - fork->start_step;
+    stats->seconds += now - fork->start_time;
+  }
+}
+
+static void profile_log(void *payload, TSLogType type, const char *message) {
+  Profile *profile = payload;
+  unsigned version, version_count;
+  int state;
+  if (type != TSLogTypeParse ||
+      sscanf(message, "process version:%u, version_count:%u, state:%d", &version, &version_count, &state) != 3) {
+    return;
+  }
+
+  double now = now_seconds();
+  profile->step++;
+  if (version_count > 1) {
+    profile->forked_steps++;
+  }
+  profile_close_forks(profile, version_count, now);
+
+  if (version_count > profile->last_version_count && profile->last_state >= 0 &&
+      (uint32_t)profile->last_state < profile->state_count) {
+    profile->states[profile->last_state].forks += version_count - profile->last_version_count;
+    if (profile->open_count < MAX_OPEN_FORKS) {
+      profile->open[profile->open_count++] = (OpenFork){
+        .state = (TSStateId)profile->last_state,
+        .base_count = profile->last_version_count,
+        .start_step = profile->step,
+        .start_time = now,
+      };
+    }
+  }
+  profile->last_version_count = version_count;
+  profile->last_state = state;
+}
+
+// Index into parse_actions for a terminal in state, as ts_language_lookup does
+static uint16_t table_lookup(const TSLanguage *language, TSStateId state, TSSymbol symbol) {
+  if (state >= language->large_state_count) {
+    uint32_t index = language->small_parse_table_map[state - language->large_state_count];
+    const uint16_t *data = &language->small_parse_table[index];
+    uint16_t group_count = *(data++);
+    for (unsigned i = 0; i < group_count; i++) {
+      uint16_t section_value = *(data++);
+      uint16_t symbol_count = *(data++);
+      for (unsigned j = 0; j < symbol_count; j++) {
+        if (*(data++) == symbol) {
+          return section_value;
+        }
+      }
+    }
+    return 0;
+  }
+  return language->parse_table[state * language->symbol_count + symbol];
+}
+
+static void json_string(FILE *out, const char *text) {
+  fputc('"', out);
+  for (const char *p = text; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      fputc('\\', out);
+      fputc(*p, out);
+    } else if ((unsigned char)*p < 0x20) {
+      fprintf(out, "\\u%04x", *p);
+    } else {
+      fputc(*p, out);
+    }
+  }
+  fputc('"', out);
+}
+
+// Print the lookaheads of state that have more than one action
+static void print_state_conflicts(FILE *out, const TSLanguage *language, TSStateId state) {
+  bool first = true;
+  fprintf(out, "[");
+  for (TSSymbol symbol = 0; symbol < language->token_count; symbol++) {
+    const TSParseActionEntry *entry = &language->parse_actions[table_lookup(language, state, symbol)];
+    if (entry->entry.count < 2) {
+      continue;
+    }
+    bool shift = false;
+    for (unsigned i = 1; i <= entry->entry.count; i++) {
+      shift = shift || entry[i].action.type == TSParseActionTypeShift;
+    }
+
+    fprintf(out, "%s\n        {\"lookahead\": ", first ? "" : ",");
+    json_string(out, language->symbol_names[symbol]);
+    fprintf(out, ", \"shift\": %s, \"reduce\": [", shift ? "true" : "false");
+    bool first_reduce = true;
+    for (unsigned i = 1; i <= entry->entry.count; i++) {
+      const TSParseAction *action = &entry[i].action;
+      if (action->type == TSParseActionTypeReduce) {
+        fprintf(out, "%s", first_reduce ? "" : ", ");
+        json_string(out, language->symbol_names[action->reduce.symbol]);
+        first_reduce = false;
+      }
+    }
+    fprintf(out, "]}");
+    first = false;
+  }
+  fprintf(out, "]");
+}
+
+typedef struct {
+  char **paths;
+  size_t count;
+} PathList;
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void collect(PathList *list, const char *path) {
+  struct stat sb;
+  if (stat(path, &sb) != 0) {
+    perror(path);
+    exit(1);
+  }
+  if (!S_ISDIR(sb.st_mode)) {
+    list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+    list->paths[list->count++] = strdup(path);
+    return;
+  }
+
+  DIR *d = opendir(path);
+  if (!d) {
+    perror(path);
+    exit(1);
+  }
+  size_t first = list->count;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    size_t len = strlen(entry->d_name);
+    if (len > 4 && strcmp(entry->d_name + len - 4, ".prp") == 0) {
+      size_t size = strlen(path) + len + 2;
+      char *file = malloc(size);
+      snprintf(file, size, "%s/%s", path, entry->d_name);
+      list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+      list->paths[list->count++] = file;
+    }
+  }
+  closedir(d);
+  qsort(list->paths + first, list->count - first, sizeof(char *), compare_strings);
+}
+
+static char *read_file(const char *path, uint32_t *length) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return NULL;
+  }
+  fseek(fp, 0L, SEEK_END);
+  long size = ftell(fp);
+  rewind(fp);
+  char *data = malloc(size + 1);
+  if (data && size > 0 && fread(data, size, 1, fp) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(fp);
+  *length = (uint32_t)size;
+  return data;
+}
+
+int main(int argc, char **argv) {
+  const char *json_path = NULL;
+  PathList inputs = {0};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    } else {
+      collect(&inputs, argv[i]);
+    }
+  }
+  if (inputs.count == 0) {
+    fprintf(stderr, "Usage: %s [--json <output_file>] <file_or_dir>...\n", argv[0]);
+    return 1;
+  }
+
+  FILE *out = stdout;
+  if (json_path && !(out = fopen(json_path, "w"))) {
+    perror(json_path);
+    return 1;
+  }
+
+  const TSLanguage *language = tree_sitter_pyrope();
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, language)) {
+    fprintf(stderr, "Error: the language was generated with an "
+                    "incompatible version of the tree-sitter CLI.\n");
+    return 1;
+  }
+
+  Profile profile = {.state_count = language->state_count};
+  profile.states = calloc(profile.state_count, sizeof(StateStats));
+  StateStats *totals = calloc(profile.state_count, sizeof(StateStats));
+
+  // Forks in files with syntax errors come from error recovery, not from
+  // grammar conflicts, so those files are reported but not profiled
+  size_t profiled = 0;
+  size_t error_files = 0;
+  uint64_t total_bytes = 0;
+  uint64_t total_steps = 0;
+  uint64_t total_forked_steps = 0;
+  double parse_seconds = 0;
+  for (size_t i = 0; i < inputs.count; i++) {
+    uint32_t length;
+    char *source = read_file(inputs.paths[i], &length);
+    if (!source) {
+      perror(inputs.paths[i]);
+      continue;
+    }
+
+    double start = now_seconds();
+    TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+    double elapsed = now_seconds() - start;
+    bool has_error = ts_node_has_error(ts_tree_root_node(tree));
+    ts_tree_delete(tree);
+
+    if (has_error) {
+      error_files++;
+    } else {
+      profile_reset(&profile);
+      ts_parser_set_logger(parser, (TSLogger){.payload = &profile, .log = profile_log});
+      tree = ts_parser_parse_string(parser, NULL, source, length);
+      ts_parser_set_logger(parser, (TSLogger){0});
+      profile_close_forks(&profile, 0, now_seconds());
+      ts_tree_delete(tree);
+
+      for (uint32_t s = 0; s < profile.state_count; s++) {
+        totals[s].forks += profile.states[s].forks;
+        totals[s].steps += profile.states[s].steps;
+        totals[s].seconds += profile.states[s].seconds;
+      }
+      total_steps += profile.step;
+      total_forked_steps += profile.forked_steps;
+      total_bytes += length;
+      parse_seconds += elapsed;
+      profiled++;
+    }
+    free(source);
+  }
+
+  fprintf(out, "{\n  \"files\": %zu, \"error_files\": %zu, \"bytes\": %llu, \"parse_seconds\": %.6f,\n",
+          profiled, error_files, (unsigned long long)total_bytes, parse_seconds);
+  fprintf(out, "  \"steps\": %llu, \"forked_steps\": %llu,\n  \"states\": [",
+          (unsigned long long)total_steps, (unsigned long long)total_forked_steps);
+  bool first = true;
+  for (uint32_t s = 0; s < profile.state_count; s++) {
+    if (totals[s].forks == 0) {
+      continue;
+    }
+    fprintf(out, "%s\n    {\"state\": %u, \"forks\": %llu, \"steps\": %llu, \"seconds\": %.6f,\n",
+            first ? "" : ",", s, (unsigned long long)totals[s].forks, (unsigned long long)totals[s].steps,
+            totals[s].seconds);
+    fprintf(out, "     \"conflicts\": ");
+    print_state_conflicts(out, language, (TSStateId)s);
+    fprintf(out, "}");
+    first = false;
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  for (size_t i = 0; i < inputs.count; i++) {
+    free(inputs.paths[i]);
+  }
+  free(inputs.paths);
+  free(profile.states);
+  free(totals);
+  ts_parser_delete(parser);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
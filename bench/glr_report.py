@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Summarize a glr_profile run by the conflicts declared in grammar.js.
+
+Each forking parse state lists the rules its conflicting actions reduce.
+A state is attributed to the declared conflict whose rules overlap those
+reductions the most; ties are listed together. States whose reductions
+match no declared conflict are grouped as "(undeclared)".
+
+Usage: glr_report.py <profile.json> [src/grammar.json]
+"""
+import json
+import os
+import re
+import sys
+
+GRAMMAR_JSON = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "grammar.json")
+
+
+def base_rule(name):
+    # Repeat helpers such as if_expression_repeat1 belong to their rule
+    return re.sub(r"_repeat\d+$", "", name)
+
+
+def reduced_rules(state):
+    return {base_rule(rule) for conflict in state["conflicts"] for rule in conflict["reduce"]}
+
+
+def attribute(state, conflicts):
+    rules = reduced_rules(state)
+    best = 0
+    matches = []
+    for conflict in conflicts:
+        score = len(rules & set(conflict))
+        if score > best:
+            best, matches = score, [conflict]
+        elif score == best and score > 0:
+            matches.append(conflict)
+    if not matches:
+        return ["(undeclared)"]
+    return [" / ".join(conflict) for conflict in matches]
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.strip())
+        sys.exit(1)
+
+    with open(sys.argv[1]) as f:
+        profile = json.load(f)
+    with open(sys.argv[2] if len(sys.argv) > 2 else GRAMMAR_JSON) as f:
+        conflicts = json.load(f).get("conflicts", [])
+
+    totals = {}
+    for state in profile["states"]:
+        names = attribute(state, conflicts)
+        for name in names:
+            entry = totals.setdefault(name, {"forks": 0, "steps": 0, "seconds": 0.0, "states": [], "shared": False})
+            entry["forks"] += state["forks"]
+            entry["steps"] += state["steps"]
+            entry["seconds"] += state["seconds"]
+            entry["states"].append(state["state"])
+            entry["shared"] = entry["shared"] or len(names) > 1
+
+    print(f"{profile['files']} files, {profile['bytes']} bytes, parse {profile['parse_seconds']:.3f}s "
+          f"({profile['error_files']} files with errors skipped)")
+    steps = profile["steps"] or 1
+    print(f"{profile['forked_steps']} of {profile['steps']} parse steps ran with more than one stack version "
+          f"({100.0 * profile['forked_steps'] / steps:.1f}%)\n")
+
+    print("Per declared conflict (time includes logging overhead; use it to rank, not as absolute cost):")
+    print(f"{'forks':>8} {'steps':>10} {'seconds':>10}  conflict")
+    for name, entry in sorted(totals.items(), key=lambda item: item[1]["seconds"], reverse=True):
+        shared = " (shared)" if entry["shared"] else ""
+        print(f"{entry['forks']:>8} {entry['steps']:>10} {entry['seconds']:>10.6f}  {name}{shared}")
+    for conflict in conflicts:
+        if " / ".join(conflict) not in totals:
+            print(f"{0:>8} {0:>10} {0:>10.6f}  {' / '.join(conflict)}")
+
+    print("\nPer parse state:")
+    print(f"{'state':>6} {'forks':>8} {'steps':>10} {'seconds':>10}  lookaheads -> reductions")
+    for state in sorted(profile["states"], key=lambda s: s["seconds"], reverse=True):
+        lookaheads = ", ".join(c["lookahead"] for c in state["conflicts"][:6])
+        if len(state["conflicts"]) > 6:
+            lookaheads += ", ..."
+        rules = ", ".join(sorted(reduced_rules(state)))
+        print(f"{state['state']:>6} {state['forks']:>8} {state['steps']:>10} {state['seconds']:>10.6f}  "
+              f"{lookaheads} -> {rules}")
+
+
+if __name__ == "__main__":
+    main()
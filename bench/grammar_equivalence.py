@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Check that a grammar variant parses the corpora exactly like grammar.js.
+
+Generates the variant (default: bench/reduced_conflicts/grammar.js) in a
+temporary directory with the tree-sitter CLI, parses every .prp file of the
+corpora with both grammars and requires identical S-expressions. It then
+times both parsers over the whole corpus and reports MB/s.
+
+With --tokens, both grammars also parse every file with --debug and the
+parse logs are counted: tokens lexed, extras shifted, and tree nodes built
+(shifted tokens plus reductions), hidden nodes included.
+
+The symbol ids of both generated parsers are compared as well. A variant
+that adds, drops or renumbers symbols cannot be adopted by regenerating
+src/ alone: the symbol enum in prpfmt/prpfmt.h and prpfmt_dispatch.c must
+be regenerated (prpfmt/gen_dispatch.py), and flat tree files written with
+the old ids are rejected. Parse cache entries miss on their own, since the
+cache key includes the parser.
+
+With --results, the outcome (mismatching files, MB/s, token counts and the
+CLI's generate warnings, e.g. unnecessary conflicts) is also written as JSON,
+to be committed next to the variant as its measured results.
+
+Usage: grammar_equivalence.py [--variant <grammar.js>] [--tree-sitter <cli>] [--tokens] [--results <file>] [corpus_dir...]
+"""
+import argparse
+import glob
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.normpath(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+DEFAULT_VARIANT = os.path.join(ROOT, "bench", "reduced_conflicts", "grammar.js")
+DEFAULT_CORPORA = [os.path.join(ROOT, "full_pyrope"), os.path.join(ROOT, "old_pyrope_snippets")]
+TIMING_RUNS = 3
+
+
+def run(cli, args, cwd):
+    return subprocess.run([cli] + args, cwd=cwd, capture_output=True, text=True)
+
+
+def parse_tree(cli, grammar_dir, path):
+    result = run(cli, ["parse", path], grammar_dir)
+    return result.returncode, result.stdout
+
+
+def time_corpus(cli, grammar_dir, files):
+    best = None
+    for _ in range(TIMING_RUNS):
+        start = time.perf_counter()
+        run(cli, ["parse", "--quiet"] + files, grammar_dir)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def count_steps(cli, grammar_dir, files):
+    counts = {"lexed": 0, "shift_extra": 0, "nodes": 0}
+    for path in files:
+        log = run(cli, ["parse", "--quiet", "--debug", path], grammar_dir).stderr
+        for line in log.splitlines():
+            if line.startswith("lexed_lookahead"):
+                counts["lexed"] += 1
+            elif line.startswith("shift_extra"):
+                counts["shift_extra"] += 1
+                counts["nodes"] += 1
+            elif line.startswith("shift") or line.startswith("reduce"):
+                counts["nodes"] += 1
+    return counts
+
+
+def symbol_ids(parser_c):
+    with open(parser_c) as f:
+        text = f.read()
+    block = re.search(r"enum ts_symbol_identifiers \{(.*?)\};", text, re.S)
+    return dict((name, int(value)) for name, value in re.findall(r"(\w+) = (\d+),", block.group(1))) if block else {}
+
+
+def compare_symbols(variant_dir):
+    base = symbol_ids(os.path.join(ROOT, "src", "parser.c"))
+    variant = symbol_ids(os.path.join(variant_dir, "src", "parser.c"))
+    return {
+        "removed": sorted(set(base) - set(variant)),
+        "added": sorted(set(variant) - set(base)),
+        "renumbered": sum(1 for name in base if name in variant and base[name] != variant[name]),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--variant", default=DEFAULT_VARIANT)
+    parser.add_argument("--tree-sitter", default=shutil.which("tree-sitter") or
+                        os.path.join(ROOT, "node_modules", "tree-sitter-cli", "tree-sitter"))
+    parser.add_argument("--tokens", action="store_true", help="compare lexed tokens and tree nodes")
+    parser.add_argument("--results", help="write the results as JSON to this file")
+    parser.add_argument("corpora", nargs="*", default=DEFAULT_CORPORA)
+    args = parser.parse_args()
+
+    cli = args.tree_sitter
+    if not os.path.exists(cli) and not shutil.which(cli):
+        print(f"ERROR (tree-sitter CLI not found at {cli})")
+        sys.exit(1)
+
+    files = sorted(f for corpus in args.corpora for f in glob.glob(os.path.join(corpus, "*.prp")))
+    if not files:
+        print("ERROR (no .prp files in the corpora)")
+        sys.exit(1)
+
+    with tempfile.TemporaryDirectory() as variant_dir:
+        # The variant requires ../../grammar.js relative to itself, so the
+        # temporary grammar.js just re-exports it
+        with open(os.path.join(variant_dir, "grammar.js"), "w") as f:
+            f.write(f"module.exports = require({os.path.abspath(args.variant)!r});\n")
+        shutil.copy(os.path.join(ROOT, "tree-sitter.json"), variant_dir)
+
+        print("Generating variant... ", end="", flush=True)
+        result = run(cli, ["generate"], variant_dir)
+        if result.returncode != 0:
+            print("FAILURE")
+            print(result.stderr)
+            sys.exit(1)
+        print("OK")
+        if result.stderr.strip():
+            print(result.stderr.strip())
+
+        mismatches = []
+        for path in files:
+            base_status, base_tree = parse_tree(cli, ROOT, path)
+            variant_status, variant_tree = parse_tree(cli, variant_dir, path)
+            if base_tree != variant_tree or base_status != variant_status:
+                mismatches.append(os.path.relpath(path, ROOT))
+                print(f"MISMATCH {mismatches[-1]}")
+        print(f"{len(files) - len(mismatches)}/{len(files)} files parse identically")
+        symbols = compare_symbols(variant_dir)
+        if symbols["removed"] or symbols["added"] or symbols["renumbered"]:
+            print(f"symbols: {len(symbols['removed'])} removed, {len(symbols['added'])} added, "
+                  f"{symbols['renumbered']} renumbered; adopting the variant needs prpfmt/gen_dispatch.py "
+                  f"and the prpfmt.h symbol enum regenerated")
+        results = {
+            "variant": os.path.relpath(os.path.abspath(args.variant), ROOT),
+            "generate_warnings": result.stderr.strip().splitlines(),
+            "files": len(files),
+            "mismatches": mismatches,
+            "symbols": symbols,
+        }
+
+        size = sum(os.path.getsize(f) for f in files) / (1024.0 * 1024.0)
+        base_time = time_corpus(cli, ROOT, files)
+        variant_time = time_corpus(cli, variant_dir, files)
+        print(f"base:    {base_time:.3f}s ({size / base_time:.2f} MB/s)")
+        print(f"variant: {variant_time:.3f}s ({size / variant_time:.2f} MB/s)")
+        results["base_mb_per_s"] = round(size / base_time, 3)
+        results["variant_mb_per_s"] = round(size / variant_time, 3)
+
+        if args.tokens:
+            base_counts = count_steps(cli, ROOT, files)
+            variant_counts = count_steps(cli, variant_dir, files)
+            print(f"{'':9}{'lexed':>10}{'extras':>10}{'nodes':>10}")
+            for name, counts in (("base:", base_counts), ("variant:", variant_counts)):
+                print(f"{name:9}{counts['lexed']:>10}{counts['shift_extra']:>10}{counts['nodes']:>10}")
+            results["base_steps"] = base_counts
+            results["variant_steps"] = variant_counts
+
+    if args.results:
+        with open(args.results, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+    sys.exit(1 if mismatches else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+'use strict';
+
+// Experimental variant of the Pyrope grammar meant to shrink the main lexer. It
+// extends ../../grammar.js and must produce exactly the same trees; check it
+// with `bench/grammar_equivalence.py --variant bench/keyword_tokens/grammar.js`
+// and measure the lexer with bench/lexer_bench.c and bench/table_size.py.
+//
+// `word: $ => $.identifier` moves every string token that looks like an
+// identifier to ts_lex_keywords, where it is matched once per identifier
+// through a single trie. _bool_literal is one token(choice('true', 'false')),
+// which the generator keeps in the main lexer: ts_lex carries t-r-u-e and
+// f-a-l-s-e chains that also have to accept an identifier at each step.
+// Here each word is a token of its own, like token('bool') for boolean_type,
+// which src/parser.c already lexes in ts_lex_keywords. Both tokens and
+// _bool_literal are hidden, so no node is added to or removed from the trees;
+// plain 'true'/'false' strings would show up as anonymous nodes instead.
+//
+// Left in the main lexer:
+// - 'and' and 'or' share a prefix with the 'and=' and 'or=' assignment
+//   operators, which are not identifiers, so they cannot be keywords.
+// - The '!and', '!has', '!is', ... operators start with '!' and only cost
+//   states after a '!'. Splitting them into '!' + keyword would add an
+//   anonymous node and change the trees.
+//
+// Status: unmeasured proposal. The variant has not been generated, so it is
+// not known to be faster or even equivalent; there is no results.json and
+// no lexer_bench or prpbench run against its parser.c yet.
+
+const base = require('../../grammar.js');
+
+module.exports = grammar(base, {
+  name: 'pyrope'
+
+  , rules: {
+    _bool_literal: $ => choice($._true_literal, $._false_literal)
+    , _true_literal: $ => token('true')
+    , _false_literal: $ => token('false')
+  }
+});
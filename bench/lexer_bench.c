@@ -0,0 +1,285 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Microbenchmark for the generated lexer. The corpus is split into tokens
+// with ts_lex in lex state 0 (where every token is valid), then the same
+// tokens are lexed again in timed rounds. Each identifier is also re-lexed
+// with ts_lex_keywords, as the runtime does for the word token, so the
+// keyword cost can be compared with the main lexer cost.
+//
+// The identifiers of the corpus are also joined into a second,
+// identifier-dense input, closer to large generated hardware descriptions.
+//
+// Usage: lexer_bench [--rounds <n>] <corpus_dir>...
+//
+// A grammar variant is measured by building with -DLEXER_BENCH_PARSER set
+// to its generated parser.c, quoted.
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef LEXER_BENCH_PARSER
+#define LEXER_BENCH_PARSER "../src/parser.c"
+#endif
+
+#include LEXER_BENCH_PARSER
+#include "../src/scanner.c"
+
+#define DEFAULT_ROUNDS 20
+
+typedef struct {
+  TSLexer base;
+  const unsigned char *data;
+  uint32_t length;
+  uint32_t position;
+  uint32_t width;
+  uint32_t token_end;
+} BenchLexer;
+
+typedef struct {
+  uint32_t start;
+  uint32_t end;
+  TSSymbol symbol;
+} Token;
+
+typedef struct {
+  Token *tokens;
+  size_t count;
+  size_t identifiers;
+} TokenList;
+
+// Decode the code point at the lexer position, as the runtime's UTF-8 lexer does
+static void bench_decode(BenchLexer *lexer) {
+  if (lexer->position >= lexer->length) {
+    lexer->base.lookahead = 0;
+    lexer->width = 0;
+    return;
+  }
+  const unsigned char *p = lexer->data + lexer->position;
+  uint32_t available = lexer->length - lexer->position;
+  int32_t c = p[0];
+  uint32_t width = 1;
+  if (c >= 0xf0 && available >= 4) {
+    c = ((c & 0x07) << 18) | ((p[1] & 0x3f) << 12) | ((p[2] & 0x3f) << 6) | (p[3] & 0x3f);
+    width = 4;
+  } else if (c >= 0xe0 && available >= 3) {
+    c = ((c & 0x0f) << 12) | ((p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+    width = 3;
+  } else if (c >= 0xc0 && available >= 2) {
+    c = ((c & 0x1f) << 6) | (p[1] & 0x3f);
+    width = 2;
+  }
+  lexer->base.lookahead = c;
+  lexer->width = width;
+}
+
+static void bench_advance(TSLexer *base, bool skip) {
+  BenchLexer *lexer = (BenchLexer *)base;
+  lexer->position += lexer->width;
+  bench_decode(lexer);
+}
+
+static void bench_mark_end(TSLexer *base) {
+  BenchLexer *lexer = (BenchLexer *)base;
+  lexer->token_end = lexer->position;
+}
+
+static uint32_t bench_get_column(TSLexer *base) { return 0; }
+
+static bool bench_is_at_included_range_start(const TSLexer *base) { return false; }
+
+static bool bench_eof(const TSLexer *base) {
+  const BenchLexer *lexer = (const BenchLexer *)base;
+  return lexer->position >= lexer->length;
+}
+
+static void bench_reset(BenchLexer *lexer, uint32_t position) {
+  lexer->position = position;
+  lexer->token_end = position;
+  bench_decode(lexer);
+}
+
+static void bench_init(BenchLexer *lexer, const char *data, size_t length) {
+  *lexer = (BenchLexer){
+    .base = {
+      .advance = bench_advance,
+      .mark_end = bench_mark_end,
+      .get_column = bench_get_column,
+      .is_at_included_range_start = bench_is_at_included_range_start,
+      .eof = bench_eof,
+    },
+    .data = (const unsigned char *)data,
+    .length = (uint32_t)length,
+  };
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Append every .prp file of dir, in sorted order, to *data
+static void load_dir(const char *dir, char **data, size_t *length) {
+  DIR *d = opendir(dir);
+  if (!d) {
+    perror(dir);
+    exit(1);
+  }
+
+  char **names = NULL;
+  size_t count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    size_t len = strlen(entry->d_name);
+    if (len > 4 && strcmp(entry->d_name + len - 4, ".prp") == 0) {
+      names = realloc(names, (count + 1) * sizeof(char *));
+      names[count++] = strdup(entry->d_name);
+    }
+  }
+  closedir(d);
+  qsort(names, count, sizeof(char *), compare_strings);
+
+  for (size_t i = 0; i < count; i++) {
+    size_t path_size = strlen(dir) + strlen(names[i]) + 2;
+    char *path = malloc(path_size);
+    snprintf(path, path_size, "%s/%s", dir, names[i]);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+      perror(path);
+      exit(1);
+    }
+    fseek(fp, 0L, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    *data = realloc(*data, *length + size);
+    if (size > 0 && fread(*data + *length, size, 1, fp) != 1) {
+      perror(path);
+      exit(1);
+    }
+    *length += size;
+    fclose(fp);
+    free(path);
+    free(names[i]);
+  }
+  free(names);
+}
+
+// Split data into tokens. Characters the lexer rejects are skipped one at a
+// time, like error recovery would
+static TokenList tokenize(const char *data, size_t length) {
+  BenchLexer lexer;
+  bench_init(&lexer, data, length);
+  TokenList list = {.tokens = malloc((length + 1) * sizeof(Token))};
+
+  uint32_t position = 0;
+  while (position < length) {
+    bench_reset(&lexer, position);
+    if (ts_lex(&lexer.base, 0) && lexer.token_end > position) {
+      list.tokens[list.count++] = (Token){position, lexer.token_end, lexer.base.result_symbol};
+      list.identifiers += lexer.base.result_symbol == sym_identifier;
+      position = lexer.token_end;
+    } else {
+      position++;
+    }
+  }
+  return list;
+}
+
+// Join the identifier tokens of list, separated by spaces
+static char *identifier_text(const char *data, const TokenList *list, size_t *length) {
+  char *text = malloc(list->count == 0 ? 1 : list->tokens[list->count - 1].end + list->count);
+  *length = 0;
+  for (size_t i = 0; i < list->count; i++) {
+    const Token *token = &list->tokens[i];
+    if (token->symbol == sym_identifier) {
+      memcpy(text + *length, data + token->start, token->end - token->start);
+      *length += token->end - token->start;
+      text[(*length)++] = ' ';
+    }
+  }
+  return text;
+}
+
+static double elapsed_seconds(const struct timespec *start) {
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return (double)(end.tv_sec - start->tv_sec) + (double)(end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static void bench_input(const char *name, const char *data, size_t length, unsigned rounds, bool last) {
+  TokenList list = tokenize(data, length);
+  BenchLexer lexer;
+  bench_init(&lexer, data, length);
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (unsigned r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < list.count; i++) {
+      bench_reset(&lexer, list.tokens[i].start);
+      ts_lex(&lexer.base, 0);
+    }
+  }
+  double lex_seconds = elapsed_seconds(&start);
+
+  // A keyword only replaces the identifier if it spans the same bytes
+  size_t keywords = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (unsigned r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < list.count; i++) {
+      const Token *token = &list.tokens[i];
+      if (token->symbol != sym_identifier) {
+        continue;
+      }
+      bench_reset(&lexer, token->start);
+      if (ts_lex_keywords(&lexer.base, 0) && lexer.token_end == token->end) {
+        keywords++;
+      }
+    }
+  }
+  double keyword_seconds = elapsed_seconds(&start);
+
+  double mb = (double)length * rounds / (1024.0 * 1024.0);
+  printf("  \"%s\": {\"bytes\": %zu, \"tokens\": %zu, \"identifiers\": %zu, \"keywords\": %zu,\n",
+         name, length, list.count, list.identifiers, keywords / rounds);
+  printf("    \"lex_ns_per_token\": %.2f, \"keyword_ns_per_identifier\": %.2f,\n",
+         lex_seconds * 1e9 / ((double)list.count * rounds),
+         keyword_seconds * 1e9 / ((double)(list.identifiers ? list.identifiers : 1) * rounds));
+  printf("    \"lex_ms_per_mb\": %.3f, \"keyword_ms_per_mb\": %.3f, \"keyword_share\": %.3f}%s\n",
+         lex_seconds * 1e3 / mb, keyword_seconds * 1e3 / mb,
+         keyword_seconds / (lex_seconds + keyword_seconds), last ? "" : ",");
+  free(list.tokens);
+}
+
+int main(int argc, char **argv) {
+  unsigned rounds = DEFAULT_ROUNDS;
+  char *data = NULL;
+  size_t length = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = (unsigned)strtoul(argv[++i], NULL, 10);
+    } else {
+      load_dir(argv[i], &data, &length);
+    }
+  }
+  if (length == 0 || rounds == 0 || length > UINT32_MAX) {
+    fprintf(stderr, "Usage: %s [--rounds <n>] <corpus_dir>...\n", argv[0]);
+    return 1;
+  }
+
+  TokenList list = tokenize(data, length);
+  size_t identifiers_length;
+  char *identifiers = identifier_text(data, &list, &identifiers_length);
+  free(list.tokens);
+
+  printf("{\"rounds\": %u,\n", rounds);
+  bench_input("corpus", data, length, rounds, false);
+  bench_input("identifiers", identifiers, identifiers_length, rounds, true);
+  printf("}\n");
+
+  free(identifiers);
+  free(data);
+  return 0;
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Fail when parser throughput or memory regressed against a baseline.
+
+Compares a prpbench JSON result with the committed baseline
+(bench/perf_baseline.json). Every (corpus, scale) entry of the baseline must
+be present in the result; its median parse MB/s may not drop by more than
+--max-slowdown and its peak RSS may not grow by more than --max-rss-growth.
+
+Timings are machine dependent: refresh the baseline with --update on the
+machine that runs the gate, and commit it together with intended slowdowns.
+Without a baseline the gate fails; it never passes by adopting the result.
+
+Usage: perf_gate.py [--baseline <file>] [--update] [--max-slowdown 0.10] [--max-rss-growth 0.20] <bench_output.json>
+"""
+import argparse
+import json
+import os
+import sys
+
+BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "perf_baseline.json")
+
+
+def entries(results):
+    # Corpus paths differ between bench.sh and the CMake target, so entries
+    # are keyed by directory name
+    keyed = {}
+    for result in results["results"]:
+        corpus = os.path.basename(os.path.normpath(result["corpus"]))
+        keyed[f"{corpus} x{result['scale']}"] = {
+            "bytes": result["bytes"],
+            "median_mb_per_s": result["parse"]["median_mb_per_s"],
+            "peak_rss_kb": result["peak_rss_kb"],
+        }
+    return keyed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--baseline", default=BASELINE)
+    parser.add_argument("--update", action="store_true", help="write the result as the new baseline")
+    parser.add_argument("--max-slowdown", type=float, default=0.10)
+    parser.add_argument("--max-rss-growth", type=float, default=0.20)
+    parser.add_argument("result")
+    args = parser.parse_args()
+
+    with open(args.result) as f:
+        current = entries(json.load(f))
+
+    if not args.update and not os.path.exists(args.baseline):
+        print(f"ERROR (no baseline at {args.baseline}; create it with --update on the reference machine)")
+        sys.exit(1)
+
+    if args.update:
+        with open(args.baseline, "w") as f:
+            json.dump(current, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"Baseline written to {args.baseline}")
+        return
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    failed = 0
+    print(f"{'entry':<28} {'MB/s':>9} {'baseline':>9} {'change':>8} {'RSS KB':>9} {'baseline':>9}")
+    for name, base in sorted(baseline.items()):
+        result = current.get(name)
+        if result is None:
+            print(f"{name:<28} missing from {args.result}")
+            failed += 1
+            continue
+        if result["bytes"] != base["bytes"]:
+            print(f"{name:<28} corpus changed ({base['bytes']} -> {result['bytes']} bytes); refresh the baseline")
+            failed += 1
+            continue
+
+        change = result["median_mb_per_s"] / base["median_mb_per_s"] - 1
+        problems = []
+        if change < -args.max_slowdown:
+            problems.append("SLOWER")
+        if result["peak_rss_kb"] > base["peak_rss_kb"] * (1 + args.max_rss_growth):
+            problems.append("RSS")
+        failed += len(problems) > 0
+        print(f"{name:<28} {result['median_mb_per_s']:>9.2f} {base['median_mb_per_s']:>9.2f} {100 * change:>+7.1f}% "
+              f"{result['peak_rss_kb']:>9} {base['peak_rss_kb']:>9}  {' '.join(problems)}")
+
+    if failed:
+        print(f"FAILURE ({failed} regressed entries)")
+        sys.exit(1)
+    print("OK")
+
+
+if __name__ == "__main__":
+    main()
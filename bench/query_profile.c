@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Query checker and profiler. Compiles each query file against
+// tree_sitter_pyrope() and reports where ts_query_new rejects it. For files
+// that compile, every pattern is compiled again on its own and run over the
+// parsed inputs, which gives its match count and its share of the match
+// time. Patterns with no match anywhere in the corpus are listed as dead:
+// they cost cursor work on every node and highlight nothing.
+//
+// Predicates (#any-of?, #match?, ...) are evaluated by the host, not by the
+// runtime, so match counts are before predicates.
+//
+// Usage: query_profile [--rounds N] <query.scm>... <file_or_dir>...
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+static const char *const query_errors[] = {"none", "syntax", "node type", "field", "capture", "structure", "language"};
+
+typedef struct {
+  char **paths;
+  size_t count;
+} PathList;
+
+typedef struct {
+  TSTree **trees;
+  size_t count;
+  uint64_t bytes;
+} Corpus;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool has_suffix(const char *text, const char *suffix) {
+  size_t len = strlen(text);
+  size_t suffix_len = strlen(suffix);
+  return len > suffix_len && strcmp(text + len - suffix_len, suffix) == 0;
+}
+
+static void append(PathList *list, char *path) {
+  list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+  list->paths[list->count++] = path;
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void collect(PathList *list, const char *path) {
+  struct stat sb;
+  if (stat(path, &sb) != 0) {
+    perror(path);
+    exit(1);
+  }
+  if (!S_ISDIR(sb.st_mode)) {
+    append(list, strdup(path));
+    return;
+  }
+
+  DIR *d = opendir(path);
+  if (!d) {
+    perror(path);
+    exit(1);
+  }
+  size_t first = list->count;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    if (has_suffix(entry->d_name, ".prp")) {
+      size_t size = strlen(path) + strlen(entry->d_name) + 2;
+      char *file = malloc(size);
+      snprintf(file, size, "%s/%s", path, entry->d_name);
+      append(list, file);
+    }
+  }
+  closedir(d);
+  qsort(list->paths + first, list->count - first, sizeof(char *), compare_strings);
+}
+
+static char *read_file(const char *path, uint32_t *length) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return NULL;
+  }
+  fseek(fp, 0L, SEEK_END);
+  long size = ftell(fp);
+  rewind(fp);
+  char *data = malloc(size + 1);
+  if (data && size > 0 && fread(data, size, 1, fp) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(fp);
+  if (data) {
+    data[size] = '\0';
+  }
+  *length = (uint32_t)size;
+  return data;
+}
+
+static void line_column(const char *text, uint32_t offset, unsigned *line, unsigned *column) {
+  *line = 1;
+  *column = 1;
+  for (uint32_t i = 0; i < offset && text[i]; i++) {
+    if (text[i] == '\n') {
+      (*line)++;
+      *column = 1;
+    } else {
+      (*column)++;
+    }
+  }
+}
+
+// Run query over every tree of corpus rounds times; returns the match count
+// of one round and adds the elapsed time to *seconds
+static uint64_t run_query(TSQueryCursor *cursor, const TSQuery *query, const Corpus *corpus, int rounds,
+                          double *seconds) {
+  uint64_t matches = 0;
+  double start = now_seconds();
+  for (int r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < corpus->count; i++) {
+      ts_query_cursor_exec(cursor, query, ts_tree_root_node(corpus->trees[i]));
+      TSQueryMatch match;
+      while (ts_query_cursor_next_match(cursor, &match)) {
+        if (r == 0) {
+          matches++;
+        }
+      }
+    }
+  }
+  *seconds += now_seconds() - start;
+  return matches;
+}
+
+// Compile path, then profile each of its patterns. Returns false if the
+// file does not compile.
+static bool profile_query(const char *path, const TSLanguage *language, const Corpus *corpus, int rounds,
+                          TSQueryCursor *cursor) {
+  uint32_t length;
+  char *source = read_file(path, &length);
+  if (!source) {
+    perror(path);
+    return false;
+  }
+
+  uint32_t error_offset;
+  TSQueryError error;
+  TSQuery *query = ts_query_new(language, source, length, &error_offset, &error);
+  if (!query) {
+    unsigned line, column;
+    line_column(source, error_offset, &line, &column);
+    printf("%s:%u:%u: %s error\n", path, line, column,
+           error < sizeof(query_errors) / sizeof(query_errors[0]) ? query_errors[error] : "unknown");
+    free(source);
+    return false;
+  }
+
+  double total_seconds = 0;
+  uint64_t total_matches = run_query(cursor, query, corpus, rounds, &total_seconds);
+  uint32_t pattern_count = ts_query_pattern_count(query);
+  printf("%s: %u patterns, %llu matches, %.3f ms per MB\n", path, pattern_count,
+         (unsigned long long)total_matches, total_seconds * 1e3 / rounds / ((double)corpus->bytes / 1e6));
+  printf("  %6s %10s %12s  %s\n", "line", "matches", "ms per MB", "pattern");
+
+  uint32_t dead = 0;
+  for (uint32_t p = 0; p < pattern_count; p++) {
+    uint32_t start = ts_query_start_byte_for_pattern(query, p);
+    uint32_t end = ts_query_end_byte_for_pattern(query, p);
+    unsigned line, column;
+    line_column(source, start, &line, &column);
+
+    // A pattern compiles on its own: captures and predicates are local to it
+    TSQuery *single = ts_query_new(language, source + start, end - start, &error_offset, &error);
+    if (!single) {
+      printf("  %6u %10s %12s  (does not compile alone)\n", line, "-", "-");
+      continue;
+    }
+    double seconds = 0;
+    uint64_t matches = run_query(cursor, single, corpus, rounds, &seconds);
+    ts_query_delete(single);
+
+    while (end > start && (source[end - 1] == '\n' || source[end - 1] == ' ')) {
+      end--;
+    }
+    uint32_t text_end = start;
+    while (text_end < end && source[text_end] != '\n' && text_end - start < 50) {
+      text_end++;
+    }
+    printf("  %6u %10llu %12.3f  %.*s%s\n", line, (unsigned long long)matches,
+           seconds * 1e3 / rounds / ((double)corpus->bytes / 1e6), (int)(text_end - start), source + start,
+           text_end < end ? " ..." : "");
+    if (matches == 0) {
+      dead++;
+    }
+  }
+  printf("  %u dead patterns (no match in %zu files)\n\n", dead, corpus->count);
+
+  ts_query_delete(query);
+  free(source);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int rounds = 20;
+  PathList queries = {0};
+  PathList inputs = {0};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else if (has_suffix(argv[i], ".scm")) {
+      append(&queries, strdup(argv[i]));
+    } else {
+      collect(&inputs, argv[i]);
+    }
+  }
+  if (queries.count == 0 || inputs.count == 0 || rounds < 1) {
+    fprintf(stderr, "Usage: %s [--rounds N] <query.scm>... <file_or_dir>...\n", argv[0]);
+    return 1;
+  }
+
+  const TSLanguage *language = tree_sitter_pyrope();
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, language)) {
+    fprintf(stderr, "Error: the language was generated with an "
+                    "incompatible version of the tree-sitter CLI.\n");
+    return 1;
+  }
+
+  Corpus corpus = {.trees = calloc(inputs.count, sizeof(TSTree *))};
+  char **sources = calloc(inputs.count, sizeof(char *));
+  for (size_t i = 0; i < inputs.count; i++) {
+    uint32_t length;
+    sources[i] = read_file(inputs.paths[i], &length);
+    if (!sources[i]) {
+      perror(inputs.paths[i]);
+      continue;
+    }
+    corpus.trees[corpus.count++] = ts_parser_parse_string(parser, NULL, sources[i], length);
+    corpus.bytes += length;
+  }
+  if (corpus.bytes == 0) {
+    fprintf(stderr, "Error: no input to run the queries on.\n");
+    return 1;
+  }
+
+  int status = 0;
+  TSQueryCursor *cursor = ts_query_cursor_new();
+  for (size_t i = 0; i < queries.count; i++) {
+    if (!profile_query(queries.paths[i], language, &corpus, rounds, cursor)) {
+      status = 1;
+    }
+    free(queries.paths[i]);
+  }
+  ts_query_cursor_delete(cursor);
+
+  for (size_t i = 0; i < inputs.count; i++) {
+    free(sources[i]);
+    free(inputs.paths[i]);
+  }
+  for (size_t i = 0; i < corpus.count; i++) {
+    ts_tree_delete(corpus.trees[i]);
+  }
+  free(sources);
+  free(corpus.trees);
+  free(queries.paths);
+  free(inputs.paths);
+  ts_parser_delete(parser);
+  return status;
+}
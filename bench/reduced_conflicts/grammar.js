@@ -0,0 +1,72 @@
+'use strict';
+
+// Experimental variant of the Pyrope grammar with fewer GLR forks on common
+// statement shapes. It extends ../../grammar.js and must produce exactly the
+// same trees; bench/grammar_equivalence.py checks that over full_pyrope/ and
+// old_pyrope_snippets/ and compares parse speed against the base grammar.
+//
+// Assignment lvalues accepted a bare identifier twice: as a typed_identifier
+// and as a complex_identifier with an optional type_cast. Every `a = ...`
+// therefore forked after `a`, and the fork only died when the versions were
+// merged (the complex_identifier tree always wins that merge). Here the
+// typed_identifier alternative of an lvalue requires its type, so `a = ...`
+// never forks and `a:u8 = ...` still yields a typed_identifier node.
+//
+// Of the three conflicts glr_report.py ranks hottest, only this one is
+// reworked. The other two stay, because resolving them with static
+// precedence would change trees:
+// - function_call_statement vs _restricted_expression: `foo(1)` must stay an
+//   expression_statement while `foo (1), 2` is a call statement; the two only
+//   differ after the closing parenthesis.
+// - lvalue_item vs _restricted_expression: `(a, b) = x` and the tuple `(a, b)`
+//   only differ at the `=`, an unbounded distance away.
+//
+// Status: unmeasured proposal. The variant has not been generated, so there
+// is no results.json, no equivalence run and no fork count yet; run the
+// grammar-variants and glr-profile targets before relying on it.
+
+const base = require('../../grammar.js');
+
+module.exports = grammar(base, {
+  name: 'pyrope'
+
+  , conflicts: ($, original) => [
+    ...original
+    , [$.complex_identifier, $._typed_lvalue]
+    , [$.timed_identifier, $._typed_lvalue]
+  ]
+
+  , rules: {
+    assignment: $ => prec.right(seq(
+      field('decl', optional($.var_or_let_or_reg))
+      , choice(
+        seq('(', field('lvalue', $.lvalue_list), ')')
+        , field('lvalue', alias($._typed_lvalue, $.typed_identifier))
+        , seq(
+          field('lvalue', $.complex_identifier)
+          , field('type', optional($.type_cast))
+        )
+      )
+      , field('operator', $.assignment_operator)
+      , field('delay', optional($.assignment_delay))
+      , field('rvalue', choice(
+        $._expression_with_comprehension
+        , $.enum_definition
+        , $.ref_identifier
+      ))
+    ))
+    , lvalue_item: $ => choice(
+      alias($._typed_lvalue, $.typed_identifier)
+      , seq(
+        field('identifier', $.complex_identifier)
+        , field('type', optional($.type_cast))
+      )
+    )
+    // A typed_identifier whose type is not optional
+    , _typed_lvalue: $ => prec.left('typed_identifier', seq(
+      field('identifier', $.identifier)
+      , optional($._timing_sequence)
+      , field('type', $.type_cast)
+    ))
+  }
+});
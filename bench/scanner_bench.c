@@ -0,0 +1,194 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Microbenchmark for the external scanner. Drives
+// tree_sitter_pyrope_external_scanner_scan with an in-memory TSLexer at every
+// place the parser can ask for an automatic semicolon (the end of each token
+// that is followed by whitespace, and before each '}') and reports the
+// scanner cost per MB of source.
+//
+// Usage: scanner_bench [--rounds <n>] <corpus_dir>...
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/scanner.c"
+
+#define DEFAULT_ROUNDS 20
+
+typedef struct {
+  TSLexer base;
+  const unsigned char *data;
+  uint32_t length;
+  uint32_t position;
+  uint32_t width;
+} BenchLexer;
+
+// Decode the code point at the lexer position, as the runtime's UTF-8 lexer does
+static void bench_decode(BenchLexer *lexer) {
+  if (lexer->position >= lexer->length) {
+    lexer->base.lookahead = 0;
+    lexer->width = 0;
+    return;
+  }
+  const unsigned char *p = lexer->data + lexer->position;
+  uint32_t available = lexer->length - lexer->position;
+  int32_t c = p[0];
+  uint32_t width = 1;
+  if (c >= 0xf0 && available >= 4) {
+    c = ((c & 0x07) << 18) | ((p[1] & 0x3f) << 12) | ((p[2] & 0x3f) << 6) | (p[3] & 0x3f);
+    width = 4;
+  } else if (c >= 0xe0 && available >= 3) {
+    c = ((c & 0x0f) << 12) | ((p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+    width = 3;
+  } else if (c >= 0xc0 && available >= 2) {
+    c = ((c & 0x1f) << 6) | (p[1] & 0x3f);
+    width = 2;
+  }
+  lexer->base.lookahead = c;
+  lexer->width = width;
+}
+
+static void bench_advance(TSLexer *base, bool skip) {
+  BenchLexer *lexer = (BenchLexer *)base;
+  lexer->position += lexer->width;
+  bench_decode(lexer);
+}
+
+static void bench_mark_end(TSLexer *base) {}
+
+static uint32_t bench_get_column(TSLexer *base) { return 0; }
+
+static bool bench_is_at_included_range_start(const TSLexer *base) { return false; }
+
+static bool bench_eof(const TSLexer *base) {
+  const BenchLexer *lexer = (const BenchLexer *)base;
+  return lexer->position >= lexer->length;
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Append every .prp file of dir, in sorted order, to *data
+static void load_dir(const char *dir, char **data, size_t *length) {
+  DIR *d = opendir(dir);
+  if (!d) {
+    perror(dir);
+    exit(1);
+  }
+
+  char **names = NULL;
+  size_t count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    size_t len = strlen(entry->d_name);
+    if (len > 4 && strcmp(entry->d_name + len - 4, ".prp") == 0) {
+      names = realloc(names, (count + 1) * sizeof(char *));
+      names[count++] = strdup(entry->d_name);
+    }
+  }
+  closedir(d);
+  qsort(names, count, sizeof(char *), compare_strings);
+
+  for (size_t i = 0; i < count; i++) {
+    size_t path_size = strlen(dir) + strlen(names[i]) + 2;
+    char *path = malloc(path_size);
+    snprintf(path, path_size, "%s/%s", dir, names[i]);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+      perror(path);
+      exit(1);
+    }
+    fseek(fp, 0L, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    *data = realloc(*data, *length + size);
+    if (size > 0 && fread(*data + *length, size, 1, fp) != 1) {
+      perror(path);
+      exit(1);
+    }
+    *length += size;
+    fclose(fp);
+    free(path);
+    free(names[i]);
+  }
+  free(names);
+}
+
+static bool is_ascii_space(unsigned char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+int main(int argc, char **argv) {
+  unsigned rounds = DEFAULT_ROUNDS;
+  char *data = NULL;
+  size_t length = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = (unsigned)strtoul(argv[++i], NULL, 10);
+    } else {
+      load_dir(argv[i], &data, &length);
+    }
+  }
+  if (length == 0 || rounds == 0 || length > UINT32_MAX) {
+    fprintf(stderr, "Usage: %s [--rounds <n>] <corpus_dir>...\n", argv[0]);
+    return 1;
+  }
+
+  // Scan sites: ends of tokens followed by whitespace, and closing braces
+  uint32_t *sites = malloc(length * sizeof(uint32_t));
+  size_t site_count = 0;
+  for (size_t i = 1; i < length; i++) {
+    unsigned char c = (unsigned char)data[i];
+    if ((is_ascii_space(c) && !is_ascii_space((unsigned char)data[i - 1])) || c == '}') {
+      sites[site_count++] = (uint32_t)i;
+    }
+  }
+
+  BenchLexer lexer = {
+    .base = {
+      .advance = bench_advance,
+      .mark_end = bench_mark_end,
+      .get_column = bench_get_column,
+      .is_at_included_range_start = bench_is_at_included_range_start,
+      .eof = bench_eof,
+    },
+    .data = (const unsigned char *)data,
+    .length = (uint32_t)length,
+  };
+  bool valid_symbols[1] = {true};
+  void *scanner = tree_sitter_pyrope_external_scanner_create();
+
+  size_t semicolons = 0;
+  uint64_t scanned = 0;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (unsigned r = 0; r < rounds; r++) {
+    for (size_t s = 0; s < site_count; s++) {
+      lexer.position = sites[s];
+      bench_decode(&lexer);
+      if (tree_sitter_pyrope_external_scanner_scan(scanner, &lexer.base, valid_symbols)) {
+        semicolons++;
+      }
+      scanned += lexer.position - sites[s];
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+  double mb = (double)length * rounds / (1024.0 * 1024.0);
+  printf("{\"bytes\": %zu, \"rounds\": %u, \"calls\": %zu, \"semicolons\": %zu, \"bytes_scanned\": %llu,\n",
+         length, rounds, site_count * rounds, semicolons, (unsigned long long)scanned);
+  printf(" \"seconds\": %.6f, \"ns_per_call\": %.2f, \"ms_per_mb\": %.3f}\n",
+         seconds, seconds * 1e9 / (double)(site_count * rounds), seconds * 1e3 / mb);
+
+  tree_sitter_pyrope_external_scanner_destroy(scanner);
+  free(sites);
+  free(data);
+  return 0;
+}
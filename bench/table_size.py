@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Report the size of the generated parse and lex tables in src/parser.c.
+
+Prints STATE_COUNT, LARGE_STATE_COUNT, the bytes of every table the parser
+touches while parsing, the lexer state counts and the non-terminals referenced
+by the most parse states (the first candidates for inline / supertypes).
+
+With --json, prints one JSON record tagged with the current git commit
+instead, so runs can be appended to a file and compared across commits.
+
+Usage: table_size.py [--json] [--top N] [src/parser.c]
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+from collections import Counter
+
+PARSER_C = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "parser.c")
+
+# Element sizes of the tables in src/tree_sitter/parser.h (LANGUAGE_VERSION 15)
+SIZEOF_PARSE_ACTION_ENTRY = 8
+SIZEOF_LEXER_MODE = 6
+
+
+def array_body(source, declaration):
+    start = source.find(declaration)
+    if start < 0:
+        return ""
+    start = source.find("{", start) + 1
+    return source[start:source.find("\n};", start)]
+
+
+def function_body(source, name):
+    start = source.find(f"static bool {name}(")
+    if start < 0:
+        return ""
+    return source[start:source.find("\n}\n", start)]
+
+
+def element_count(body):
+    # Every element of the generated arrays is followed by a comma, and the
+    # macros used in them (ACTIONS, STATE, SMALL_STATE) take one argument
+    return body.count(",")
+
+
+def parse_action_count(body):
+    last = None
+    for last in re.finditer(r"\[(\d+)\] = \{\.entry = \{\.count = (\d+)", body):
+        pass
+    if last is None:
+        return 0
+    return int(last.group(1)) + 1 + int(last.group(2))
+
+
+def git_commit(path):
+    result = subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=os.path.dirname(path),
+                            capture_output=True, text=True)
+    return result.stdout.strip() if result.returncode == 0 else None
+
+
+def measure(path):
+    with open(path) as f:
+        source = f.read()
+    defines = {name: int(value) for name, value in re.findall(r"^#define (\w+) (\d+)$", source, re.M)}
+    state_count = defines["STATE_COUNT"]
+    large_state_count = defines["LARGE_STATE_COUNT"]
+    symbol_count = defines["SYMBOL_COUNT"]
+
+    small_table = array_body(source, "ts_small_parse_table[] =")
+    bytes_ = {
+        "parse_table": large_state_count * symbol_count * 2,
+        "small_parse_table": element_count(small_table) * 2,
+        "small_parse_table_map": (state_count - large_state_count) * 4,
+        "parse_actions": parse_action_count(array_body(source, "ts_parse_actions[] =")) * SIZEOF_PARSE_ACTION_ENTRY,
+        "lex_modes": state_count * SIZEOF_LEXER_MODE,
+        "primary_state_ids": state_count * 2,
+    }
+
+    # Non-terminal references (gotos), counted once per state
+    non_terminals = {name for name, value in re.findall(r"^  ((?:aux_)?sym_\w+) = (\d+),$", source, re.M)
+                     if int(value) >= defines["TOKEN_COUNT"]}
+    references = Counter()
+    for state in re.split(r"\n  \[\d+\] = ", small_table):
+        references.update(non_terminals.intersection(re.findall(r"\b((?:aux_)?sym_\w+)\b", state)))
+    for row in re.split(r"\n  \[STATE\(\d+\)\] = \{", array_body(source, "ts_parse_table[LARGE_STATE_COUNT]")):
+        references.update(non_terminals.intersection(re.findall(r"\[((?:aux_)?sym_\w+)\] = STATE", row)))
+
+    return {
+        "commit": git_commit(path),
+        "state_count": state_count,
+        "large_state_count": large_state_count,
+        "symbol_count": symbol_count,
+        "token_count": defines["TOKEN_COUNT"],
+        "production_id_count": defines["PRODUCTION_ID_COUNT"],
+        "aux_repeat_count": len(set(re.findall(r"^  aux_sym_\w+_repeat\d+ = \d+,$", source, re.M))),
+        "lex_states": len(re.findall(r"^    case \d+:", function_body(source, "ts_lex"), re.M)),
+        "keyword_lex_states": len(re.findall(r"^    case \d+:", function_body(source, "ts_lex_keywords"), re.M)),
+        "table_bytes": bytes_,
+        "total_table_bytes": sum(bytes_.values()),
+        "source_bytes": len(source),
+        "references": references,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--json", action="store_true", help="print one JSON record")
+    parser.add_argument("--top", type=int, default=15, help="non-terminals to list")
+    parser.add_argument("parser_c", nargs="?", default=PARSER_C)
+    args = parser.parse_args()
+
+    if not os.path.exists(args.parser_c):
+        print(f"ERROR ({args.parser_c} not found)")
+        sys.exit(1)
+    report = measure(args.parser_c)
+    references = report.pop("references")
+
+    if args.json:
+        print(json.dumps(report, sort_keys=True))
+        return
+
+    print(f"commit:             {report['commit'] or '(unknown)'}")
+    print(f"STATE_COUNT:        {report['state_count']}")
+    print(f"LARGE_STATE_COUNT:  {report['large_state_count']}")
+    print(f"SYMBOL_COUNT:       {report['symbol_count']} ({report['token_count']} tokens, "
+          f"{report['aux_repeat_count']} aux repeats)")
+    print(f"productions:        {report['production_id_count']}")
+    print(f"lex states:         {report['lex_states']} (+{report['keyword_lex_states']} keyword)")
+    print(f"parser.c:           {report['source_bytes'] / 1024.0:.0f} KiB of source\n")
+
+    print("Table bytes:")
+    for name, size in sorted(report["table_bytes"].items(), key=lambda item: item[1], reverse=True):
+        print(f"  {name:<24} {size:>10}")
+    print(f"  {'total':<24} {report['total_table_bytes']:>10}\n")
+
+    print(f"Non-terminals referenced by the most parse states (of {report['state_count']}):")
+    for symbol, count in references.most_common(args.top):
+        print(f"  {count:>6}  {symbol}")
+
+
+if __name__ == "__main__":
+    main()
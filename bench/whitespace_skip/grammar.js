@@ -0,0 +1,41 @@
+'use strict';
+
+// Experimental variant of the Pyrope grammar that does not turn whitespace
+// into tokens. It extends ../../grammar.js and must produce exactly the same
+// trees; check it with
+// `bench/grammar_equivalence.py --variant bench/whitespace_skip/grammar.js --tokens`,
+// which also compares lexed tokens, shifted extras and tree nodes.
+//
+// The base grammar lists `_space`, a one-character token, in extras, so every
+// space, tab and newline is lexed, shifted as an extra and kept as a hidden
+// leaf of the tree. With the same character class written as a pattern in
+// extras, the generated lexer skips it as a separator inside ts_lex (SKIP
+// instead of ACCEPT_TOKEN): no token, no parse step, no tree node. _space was
+// hidden, so no visible node changes.
+//
+// The automatic semicolon is unaffected: the runtime calls the external
+// scanner at the end of the previous token, before any separator is skipped,
+// and src/scanner.c already skips leading whitespace itself to find the
+// newline (the layout tree-sitter-javascript, which the scanner follows, uses).
+//
+// Dropping _space removes a symbol, so every symbol after it is renumbered
+// (grammar_equivalence.py reports this under "symbols"). Adopting this in
+// grammar.js means, besides regenerating src/:
+//   - regenerating the symbol enum in prpfmt/prpfmt.h and
+//     prpfmt/prpfmt_dispatch.c with prpfmt/gen_dispatch.py; the build fails
+//     until both match src/parser.c;
+//   - rewriting flat tree files (prpfmt_flat_write) kept by downstream tools,
+//     which store symbol ids and are rejected by the new parser;
+//   - nothing for the parse cache, whose key includes the parser, so old
+//     entries simply miss.
+//
+// Status: unmeasured proposal. It has not been generated, so there are no
+// before/after token and node counts or MB/s, and no results.json.
+
+const base = require('../../grammar.js');
+
+module.exports = grammar(base, {
+  name: 'pyrope'
+
+  , extras: $ => [/[\s\p{Zs}\uFEFF\u2060\u200B]/, $.comment]
+});
@@ -7,3 +7,39 @@ test("can load grammar", () => {
   const parser = new Parser();
   assert.doesNotThrow(() => parser.setLanguage(require(".")));
 });
+
+test("parse budget", () => {
+  const language = require(".");
+  const parser = new Parser();
+  parser.setLanguage(language);
+  // Long enough for the runtime to check the budget many times
+  const source = "const a = 1\n".repeat(10000);
+  const assertReset = () => {
+    // The parser is reset, so the next parse starts from scratch
+    const fresh = new Parser();
+    fresh.setLanguage(language);
+    const tree = language.parseWithBudget(parser, source);
+    assert.strictEqual(tree.rootNode.toString(), fresh.parse(source).rootNode.toString());
+  };
+
+  // A clock that advances a second per reading: the deadline has passed at
+  // the first budget check, however fast the parse is
+  const hrtime = process.hrtime.bigint;
+  let now = 0n;
+  process.hrtime.bigint = () => (now += 1000000000n);
+  try {
+    assert.throws(() => language.parseWithBudget(parser, source, { timeoutMicros: 1000 }), /time limit exceeded/);
+  } finally {
+    process.hrtime.bigint = hrtime;
+  }
+  assertReset();
+
+  // signal is only checked before the parse starts
+  const controller = new AbortController();
+  controller.abort();
+  assert.throws(() => language.parseWithBudget(parser, source, { signal: controller.signal }), /cancelled/);
+  assertReset();
+
+  const tree = language.parseWithBudget(parser, "const a = 1\n", { timeoutMicros: 10000000 });
+  assert.ok(!tree.rootNode.hasError);
+});
@@ -18,9 +18,21 @@ type NodeInfo =
       children: ChildNode[];
     });
 
+type ParseBudget = {
+  timeoutMicros?: number;
+  /** Checked only before the parse starts; parsing is synchronous, so it cannot be aborted mid-parse. */
+  signal?: AbortSignal;
+};
+
+declare class ParseAborted extends Error {
+  reason: "time limit exceeded" | "cancelled";
+}
+
 type Language = {
   language: unknown;
   nodeTypeInfo: NodeInfo[];
+  ParseAborted: typeof ParseAborted;
+  parseWithBudget(parser: unknown, source: string, budget?: ParseBudget): unknown;
 };
 
 declare const language: Language;
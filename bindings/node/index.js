@@ -9,3 +9,57 @@ module.exports =
 try {
   module.exports.nodeTypeInfo = require("../../src/node-types.json");
 } catch (_) {}
+
+class ParseAborted extends Error {
+  constructor(reason) {
+    super(`parse aborted: ${reason}`);
+    this.name = "ParseAborted";
+    this.reason = reason;
+  }
+}
+
+// Parse source with a tree-sitter Parser, giving up after timeoutMicros
+// (0: no limit). Throws ParseAborted instead of returning a partial tree; the
+// parser is reset and ready for the next source.
+//
+// signal (an AbortSignal) is only checked before the parse starts:
+// parser.parse is synchronous, so nothing can abort the signal while it runs.
+// Use timeoutMicros to bound a parse in progress.
+function parseWithBudget(parser, source, { timeoutMicros = 0, signal } = {}) {
+  const deadline = timeoutMicros ? process.hrtime.bigint() + BigInt(timeoutMicros) * 1000n : 0n;
+  let reason = null;
+  const progressCallback = () => {
+    if (deadline && process.hrtime.bigint() >= deadline) {
+      reason = "time limit exceeded";
+    }
+    return reason !== null;
+  };
+
+  let tree = null;
+  if (signal && signal.aborted) {
+    reason = "cancelled";
+  } else {
+    // Older node bindings ignore progressCallback but honour a parser timeout
+    const hasTimeout = timeoutMicros && typeof parser.setTimeoutMicros === "function";
+    if (hasTimeout) {
+      parser.setTimeoutMicros(timeoutMicros);
+    }
+    try {
+      tree = parser.parse(source, undefined, { progressCallback });
+    } catch (_) {
+      tree = null;
+    } finally {
+      if (hasTimeout) {
+        parser.setTimeoutMicros(0);
+      }
+    }
+  }
+  if (!tree) {
+    parser.reset();
+    throw new ParseAborted(reason || "time limit exceeded");
+  }
+  return tree;
+}
+
+module.exports.ParseAborted = ParseAborted;
+module.exports.parseWithBudget = parseWithBudget;
@@ -1,4 +1,7 @@
+from itertools import count
+from threading import Event
 from unittest import TestCase
+from unittest.mock import patch
 
 import tree_sitter
 import tree_sitter_pyrope
@@ -10,3 +13,38 @@ class TestLanguage(TestCase):
             tree_sitter.Language(tree_sitter_pyrope.language())
         except Exception:
             self.fail("Error loading Pyrope grammar")
+
+
+class TestParseBudget(TestCase):
+    # Long enough for the runtime to check the budget many times
+    SOURCE = b"const a = 1\n" * 10000
+
+    def setUp(self):
+        self.parser = tree_sitter.Parser(tree_sitter.Language(tree_sitter_pyrope.language()))
+
+    def assert_reset(self):
+        # The parser is reset, so the next parse starts from scratch
+        fresh = tree_sitter.Parser(tree_sitter.Language(tree_sitter_pyrope.language()))
+        tree = tree_sitter_pyrope.parse_with_budget(self.parser, self.SOURCE)
+        self.assertEqual(str(tree.root_node), str(fresh.parse(self.SOURCE).root_node))
+
+    def test_parses_within_budget(self):
+        tree = tree_sitter_pyrope.parse_with_budget(self.parser, b"const a = 1\n", timeout_micros=10_000_000)
+        self.assertFalse(tree.root_node.has_error)
+
+    def test_time_limit(self):
+        # A clock that advances a second per reading: the deadline has passed
+        # at the first budget check, however fast the parse is
+        with patch("tree_sitter_pyrope._monotonic", side_effect=count(0.0, 1.0)):
+            with self.assertRaises(tree_sitter_pyrope.ParseAborted) as aborted:
+                tree_sitter_pyrope.parse_with_budget(self.parser, self.SOURCE, timeout_micros=1000)
+        self.assertEqual(aborted.exception.reason, "time limit exceeded")
+        self.assert_reset()
+
+    def test_cancel(self):
+        cancel = Event()
+        cancel.set()
+        with self.assertRaises(tree_sitter_pyrope.ParseAborted) as aborted:
+            tree_sitter_pyrope.parse_with_budget(self.parser, self.SOURCE, cancel=cancel)
+        self.assertEqual(aborted.exception.reason, "cancelled")
+        self.assert_reset()
@@ -1,10 +1,60 @@
 """Pyrope grammar for tree-sitter"""
 
 from importlib.resources import files as _files
+from time import monotonic as _monotonic
 
 from ._binding import language
 
 
+class ParseAborted(Exception):
+    """Raised by parse_with_budget when the parse ran out of time or was cancelled."""
+
+    def __init__(self, reason):
+        super().__init__(f"parse aborted: {reason}")
+        self.reason = reason
+
+
+def parse_with_budget(parser, source, timeout_micros=0, cancel=None):
+    """Parse source (bytes) with a tree_sitter.Parser, giving up after
+    timeout_micros (0: no limit) or once cancel (e.g. a threading.Event) is
+    set from another thread. Raises ParseAborted instead of returning a
+    partial tree; the parser is reset and ready for the next source.
+    """
+    deadline = _monotonic() + timeout_micros / 1e6 if timeout_micros else None
+    reason = None
+
+    def progress(*_):
+        nonlocal reason
+        if cancel is not None and cancel.is_set():
+            reason = "cancelled"
+        elif deadline is not None and _monotonic() >= deadline:
+            reason = "time limit exceeded"
+        return reason is not None
+
+    try:
+        tree = parser.parse(source, progress_callback=progress)
+    except TypeError:
+        # py-tree-sitter before 0.25 has no progress callback, only a timeout
+        if cancel is not None and cancel.is_set():
+            reason = "cancelled"
+            tree = None
+        else:
+            parser.timeout_micros = timeout_micros
+            try:
+                tree = parser.parse(source)
+            except ValueError:
+                tree = None
+            finally:
+                parser.timeout_micros = 0
+            reason = "time limit exceeded"
+    except ValueError:
+        tree = None
+    if tree is None:
+        parser.reset()
+        raise ParseAborted(reason or "time limit exceeded")
+    return tree
+
+
 def _get_query(name, file):
     query = _files(f"{__package__}.queries") / file
     globals()[name] = query.read_text()
@@ -28,6 +78,8 @@ def __getattr__(name):
 
 __all__ = [
     "language",
+    "parse_with_budget",
+    "ParseAborted",
     # "HIGHLIGHTS_QUERY",
     # "INJECTIONS_QUERY",
     # "LOCALS_QUERY",
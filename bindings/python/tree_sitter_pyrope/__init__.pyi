@@ -1,4 +1,4 @@
-from typing import Final
+from typing import Final, Optional, Protocol
 
 # NOTE: uncomment these to include any queries that this grammar contains:
 
@@ -8,3 +8,13 @@ from typing import Final
 # TAGS_QUERY: Final[str]
 
 def language() -> object: ...
+
+class _Cancel(Protocol):
+    def is_set(self) -> bool: ...
+
+class ParseAborted(Exception):
+    reason: str
+
+def parse_with_budget(
+    parser: object, source: bytes, timeout_micros: int = 0, cancel: Optional[_Cancel] = None
+) -> object: ...
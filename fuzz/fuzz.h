@@ -0,0 +1,47 @@
+#ifndef PYROPE_FUZZ_H
+#define PYROPE_FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// Performance limits shared by the fuzz harnesses. An input that breaks one
+// is reported like a crash (abort), so libFuzzer saves and minimizes it.
+// Each limit can be overridden from the environment for slower machines or
+// sanitizer builds:
+//
+//   PYROPE_FUZZ_MIN_RATE       bytes per microsecond a parse or format must
+//                              keep up, on top of a fixed allowance (default 1,
+//                              i.e. 1 MB/s; clean builds run 10-40 MB/s)
+//   PYROPE_FUZZ_GRACE_MS       fixed allowance per input (default 20)
+//   PYROPE_FUZZ_NODES_PER_BYTE tree nodes allowed per input byte (default 16)
+//   PYROPE_FUZZ_DEPTH_PER_BYTE tree depth allowed per input byte (default 8)
+//   PYROPE_FUZZ_MAX_DEPTH      depth allowed on top of that (default 256)
+//
+// Depth scales with the input: every nesting level of valid Pyrope costs at
+// least an opening and a closing byte and adds a few tree levels, so deep
+// but linearly parsed input such as nested parentheses stays within the
+// limit; a tree deeper than the input can explain does not. Tree depth says
+// nothing about GLR stack versions; input that keeps the parser forked is
+// caught by the parse rate.
+typedef struct {
+  double min_rate;
+  uint64_t grace_micros;
+  uint64_t nodes_per_byte;
+  uint64_t depth_per_byte;
+  uint32_t max_depth;
+} FuzzLimits;
+
+const FuzzLimits *fuzz_limits(void);
+
+// Time allowed for a phase over length bytes
+uint64_t fuzz_allowed_micros(size_t length);
+uint64_t fuzz_now_micros(void);
+
+// Walk tree and report excessive node count or depth
+void fuzz_check_tree(const TSTree *tree, size_t length);
+
+// Print the finding and abort
+void fuzz_finding(const char *format, ...) __attribute__((noreturn, format(printf, 1, 2)));
+
+#endif  // PYROPE_FUZZ_H
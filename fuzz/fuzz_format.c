@@ -0,0 +1,79 @@
+// libFuzzer harness for parse + print_tree. Inputs that parse with errors
+// are not formatted, like in prpfmt. Besides crashes, it reports a parse or
+// a format slower than PYROPE_FUZZ_MIN_RATE, trees that grow out of
+// proportion to the input (see fuzz.h), and output more than four times
+// the size of the input.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuzz.h"
+#include "prpfmt.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+static TSParser *parser;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+  (void)argc;
+  (void)argv;
+  parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_pyrope());
+  prpfmt_init(tree_sitter_pyrope());
+  fuzz_limits();
+  return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size > UINT32_MAX) {
+    return 0;
+  }
+  // The printers read the source as a C string
+  char *source = malloc(size + 1);
+  if (!source) {
+    return 0;
+  }
+  memcpy(source, data, size);
+  source[size] = '\0';
+
+  PrpfmtParseBudget budget = {.timeout_micros = fuzz_allowed_micros(size)};
+  PrpfmtParseStatus status;
+  uint64_t start = fuzz_now_micros();
+  prpfmt_budget_start(&budget);
+  TSTree *tree = prpfmt_parse_string(parser, NULL, source, (uint32_t)size, &budget, &status);
+  if (!tree) {
+    fuzz_finding("slow parse: %zu bytes not parsed in %llu us", size,
+                 (unsigned long long)(fuzz_now_micros() - start));
+  }
+  fuzz_check_tree(tree, size);
+  if (ts_node_has_error(ts_tree_root_node(tree))) {
+    ts_tree_delete(tree);
+    free(source);
+    return 0;
+  }
+
+  PrpfmtSink output;
+  prpfmt_sink_init_memory(&output);
+  PrpfmtState state = {
+    .source_code = source,
+    .out = &output,
+    .indent_level = 0,
+    .indent_size = 2,
+    .fmt_on = true
+  };
+  start = fuzz_now_micros();
+  print_tree(tree, &state);
+  uint64_t elapsed = fuzz_now_micros() - start;
+  if (elapsed > fuzz_allowed_micros(size)) {
+    fuzz_finding("slow format: %zu bytes formatted in %llu us (limit %llu us)", size, (unsigned long long)elapsed,
+                 (unsigned long long)fuzz_allowed_micros(size));
+  }
+  if (output.length > 4 * (size_t)size + 1024) {
+    fuzz_finding("output growth: %zu bytes formatted to %zu", size, output.length);
+  }
+
+  prpfmt_sink_destroy(&output);
+  ts_tree_delete(tree);
+  free(source);
+  return 0;
+}
@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "fuzz.h"
+
+static FuzzLimits limits;
+static bool limits_read;
+
+static double env_number(const char *name, double fallback) {
+  const char *value = getenv(name);
+  return value && *value ? strtod(value, NULL) : fallback;
+}
+
+const FuzzLimits *fuzz_limits(void) {
+  if (!limits_read) {
+    limits.min_rate = env_number("PYROPE_FUZZ_MIN_RATE", 1.0);
+    limits.grace_micros = (uint64_t)(env_number("PYROPE_FUZZ_GRACE_MS", 20) * 1000);
+    limits.nodes_per_byte = (uint64_t)env_number("PYROPE_FUZZ_NODES_PER_BYTE", 16);
+    limits.depth_per_byte = (uint64_t)env_number("PYROPE_FUZZ_DEPTH_PER_BYTE", 8);
+    limits.max_depth = (uint32_t)env_number("PYROPE_FUZZ_MAX_DEPTH", 256);
+    limits_read = true;
+  }
+  return &limits;
+}
+
+uint64_t fuzz_allowed_micros(size_t length) {
+  const FuzzLimits *l = fuzz_limits();
+  return l->grace_micros + (l->min_rate > 0 ? (uint64_t)((double)length / l->min_rate) : 0);
+}
+
+uint64_t fuzz_now_micros(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+void fuzz_finding(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "==pyrope-fuzz== ");
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  abort();
+}
+
+void fuzz_check_tree(const TSTree *tree, size_t length) {
+  const FuzzLimits *l = fuzz_limits();
+  uint64_t max_nodes = 256 + l->nodes_per_byte * (uint64_t)length;
+  uint64_t depth_limit = l->max_depth + l->depth_per_byte * (uint64_t)length;
+  uint64_t nodes = 0;
+  uint32_t depth = 0;
+  uint32_t max_depth = 0;
+
+  // Pre-order walk with the tree cursor; no recursion, so a deep tree is
+  // measured rather than overflowing the harness stack
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  for (;;) {
+    nodes++;
+    if (depth > max_depth) {
+      max_depth = depth;
+    }
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      depth++;
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        goto done;
+      }
+      depth--;
+    }
+  }
+done:
+  if (nodes > max_nodes) {
+    fuzz_finding("tree growth: %llu nodes for %zu bytes (limit %llu)", (unsigned long long)nodes, length,
+                 (unsigned long long)max_nodes);
+  }
+  if (max_depth > depth_limit) {
+    fuzz_finding("tree depth %u for %zu bytes (limit %llu)", max_depth, length, (unsigned long long)depth_limit);
+  }
+}
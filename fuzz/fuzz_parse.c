@@ -0,0 +1,45 @@
+// libFuzzer harness for tree_sitter_pyrope(). Besides crashes, it reports
+// parses slower than PYROPE_FUZZ_MIN_RATE and trees that grow out of
+// proportion to the input (see fuzz.h). The parse runs under a
+// PrpfmtParseBudget of the allowed time, so a performance cliff is reported
+// as soon as it is hit instead of as a libFuzzer timeout.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuzz.h"
+#include "prpfmt.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+static TSParser *parser;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+  (void)argc;
+  (void)argv;
+  parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_pyrope());
+  fuzz_limits();
+  return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  if (size > UINT32_MAX) {
+    return 0;
+  }
+
+  PrpfmtParseBudget budget = {.timeout_micros = fuzz_allowed_micros(size)};
+  PrpfmtParseStatus status;
+  uint64_t start = fuzz_now_micros();
+  prpfmt_budget_start(&budget);
+  TSTree *tree = prpfmt_parse_string(parser, NULL, (const char *)data, (uint32_t)size, &budget, &status);
+  if (!tree) {
+    uint64_t elapsed = fuzz_now_micros() - start;
+    fuzz_finding("slow parse: %zu bytes not parsed in %llu us (%.3f bytes/us)", size, (unsigned long long)elapsed,
+                 (double)size / (double)elapsed);
+  }
+
+  fuzz_check_tree(tree, size);
+  ts_tree_delete(tree);
+  return 0;
+}
@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 200809L
+
+// Driver for building the harnesses without libFuzzer (e.g. with gcc): runs
+// LLVMFuzzerTestOneInput once on every file given, and on every file in the
+// directories given. Used to replay seeds/ and crash files.
+//
+// Usage: fuzz_<harness> <file_or_dir>...
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void run_file(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    perror(path);
+    exit(1);
+  }
+  fseek(fp, 0L, SEEK_END);
+  long size = ftell(fp);
+  rewind(fp);
+  uint8_t *data = malloc(size > 0 ? size : 1);
+  if (!data || (size > 0 && fread(data, size, 1, fp) != 1)) {
+    perror(path);
+    exit(1);
+  }
+  fclose(fp);
+
+  fprintf(stderr, "Running: %s\n", path);
+  LLVMFuzzerTestOneInput(data, (size_t)size);
+  free(data);
+}
+
+static void run_path(const char *path) {
+  struct stat sb;
+  if (stat(path, &sb) != 0) {
+    perror(path);
+    exit(1);
+  }
+  if (!S_ISDIR(sb.st_mode)) {
+    run_file(path);
+    return;
+  }
+
+  DIR *d = opendir(path);
+  if (!d) {
+    perror(path);
+    exit(1);
+  }
+  char **names = NULL;
+  size_t count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    if (entry->d_name[0] != '.') {
+      names = realloc(names, (count + 1) * sizeof(char *));
+      names[count++] = strdup(entry->d_name);
+    }
+  }
+  closedir(d);
+  qsort(names, count, sizeof(char *), compare_strings);
+  for (size_t i = 0; i < count; i++) {
+    size_t size = strlen(path) + strlen(names[i]) + 2;
+    char *file = malloc(size);
+    snprintf(file, size, "%s/%s", path, names[i]);
+    run_path(file);
+    free(file);
+    free(names[i]);
+  }
+  free(names);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <file_or_dir>...\n", argv[0]);
+    return 1;
+  }
+  LLVMFuzzerInitialize(&argc, &argv);
+  for (int i = 1; i < argc; i++) {
+    run_path(argv[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,19 @@
+# Write OUTPUT, a C file holding prpfmt_parser_hash, a hash of the parser in
+# PARSER, and prpfmt_output_version, a hash of the printer sources in
+# PRINTERS (a ;-separated list).
+# Run with cmake -DPARSER=... -DPRINTERS=... -DOUTPUT=... -P build_hash.cmake
+file(SHA256 "${PARSER}" parser)
+set(printers "")
+foreach(source IN LISTS PRINTERS)
+  file(SHA256 "${source}" source_hash)
+  string(APPEND printers "${source_hash}")
+endforeach()
+string(SHA256 printers "${printers}")
+string(SUBSTRING "${parser}" 0 16 parser)
+string(SUBSTRING "${printers}" 0 16 printers)
+
+file(WRITE "${OUTPUT}"
+     "// Generated by build_hash.cmake from src/parser.c and the printers; do not edit\n\n"
+     "#include <stdint.h>\n\n"
+     "const uint64_t prpfmt_parser_hash = 0x${parser}ULL;\n"
+     "const uint64_t prpfmt_output_version = 0x${printers}ULL;\n")
@@ -0,0 +1,26 @@
+# Write OUTPUT, a C file holding the text of the query files in QUERIES
+# (a ;-separated list in PrpfmtQueryKind order) as byte arrays.
+# Run with cmake -DQUERIES=... -DOUTPUT=... -P embed_queries.cmake
+set(sources "")
+set(arrays "")
+set(lengths "")
+set(index 0)
+foreach(query IN LISTS QUERIES)
+  file(READ "${query}" hex HEX)
+  string(LENGTH "${hex}" hex_length)
+  math(EXPR length "${hex_length} / 2")
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+  string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)" "\\1\n  " bytes "${bytes}")
+  get_filename_component(name "${query}" NAME)
+  string(APPEND arrays "// ${name}\nstatic const char query_${index}[] = {\n  ${bytes}0x00};\n\n")
+  string(APPEND sources "  query_${index},\n")
+  string(APPEND lengths "  ${length},\n")
+  math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE "${OUTPUT}"
+     "// Generated by embed_queries.cmake from queries/*.scm; do not edit\n\n"
+     "#include <stdint.h>\n\n"
+     "${arrays}"
+     "const char *const prpfmt_query_sources[] = {\n${sources}};\n\n"
+     "const uint32_t prpfmt_query_lengths[] = {\n${lengths}};\n")
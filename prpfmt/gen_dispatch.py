@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Generate prpfmt_dispatch.c, the symbol-to-printer table of prpfmt.
+
+Every named node type in src/node-types.json that has a printer declared in
+prpfmt.h (print_<type>) gets that printer in prpfmt_printers[], indexed by
+its symbol from the enum in prpfmt.h. prpfmt_layout[] holds the flags that
+print_statement needs: which types are statements (the children of
+`statement`), which are extras such as comments, and which print their own
+indentation.
+
+--check regenerates the table in memory and fails if prpfmt_dispatch.c is
+out of date, or if the symbol enum in prpfmt.h no longer matches
+src/parser.c (i.e. the parser was regenerated and the header was not).
+
+Usage: gen_dispatch.py [--check]
+"""
+import argparse
+import json
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(HERE, "..")
+NODE_TYPES = os.path.join(ROOT, "src", "node-types.json")
+PARSER_C = os.path.join(ROOT, "src", "parser.c")
+HEADER = os.path.join(HERE, "prpfmt.h")
+OUTPUT = os.path.join(HERE, "prpfmt_dispatch.c")
+
+# Statements that indent themselves instead of being indented by print_statement
+OWN_INDENT = {"scope_statement"}
+
+ENUM_RE = re.compile(r"^  ((?:aux_|anon_|alias_)?sym_\w+) = (\d+),$", re.M)
+
+
+def read(path):
+    try:
+        with open(path) as f:
+            return f.read()
+    except OSError as e:
+        print(f"ERROR (could not read {path}: {e})")
+        sys.exit(1)
+
+
+def check_enum(header, parser_c):
+    """Return the problems with the enum and count in prpfmt.h against parser.c"""
+    problems = []
+    expected = dict(ENUM_RE.findall(parser_c))
+    actual = dict(ENUM_RE.findall(header))
+    for name, value in sorted(expected.items(), key=lambda item: int(item[1])):
+        if actual.get(name) != value:
+            problems.append(f"{name} is {actual.get(name, 'missing')} in prpfmt.h, {value} in parser.c")
+    for name in sorted(set(actual) - set(expected)):
+        problems.append(f"{name} is in prpfmt.h but not in parser.c")
+
+    count = re.search(r"#define SYMBOL_COUNT (\d+)", parser_c)
+    header_count = re.search(r"#define PRPFMT_SYMBOL_COUNT (\d+)", header)
+    if not count or not header_count or count.group(1) != header_count.group(1):
+        problems.append(f"PRPFMT_SYMBOL_COUNT is {header_count and header_count.group(1)}, "
+                        f"SYMBOL_COUNT is {count and count.group(1)}")
+    return problems
+
+
+def generate(node_types, header):
+    symbols = {name for name, _ in ENUM_RE.findall(header)}
+    printers = set(re.findall(r"^void (print_\w+)\(TSNode node, PrpfmtState \*st\);", header, re.M))
+
+    statements = set()
+    for entry in node_types:
+        if entry["type"] == "statement":
+            statements = {t["type"] for t in entry.get("children", {}).get("types", []) if t["named"]}
+
+    table = []
+    for entry in node_types:
+        name = entry["type"]
+        if not entry["named"] or name.startswith("_"):
+            continue
+        symbol = f"sym_{name}"
+        printer = f"print_{name}"
+        if symbol not in symbols or printer not in printers:
+            continue
+        flags = []
+        if name in statements:
+            flags.append("PRPFMT_LAYOUT_STATEMENT")
+        if entry.get("extra"):
+            flags.append("PRPFMT_LAYOUT_EXTRA")
+        if name in OWN_INDENT:
+            flags.append("PRPFMT_LAYOUT_OWN_INDENT")
+        table.append((symbol, printer, flags))
+    table.sort()
+
+    lines = [
+        "// Generated by gen_dispatch.py from src/node-types.json and prpfmt.h; do not edit.",
+        "",
+        '#include "prpfmt.h"',
+        "",
+        "const PrpfmtPrinter prpfmt_printers[PRPFMT_SYMBOL_COUNT] = {",
+    ]
+    lines += [f"  [{symbol}] = {printer}," for symbol, printer, _ in table]
+    lines += ["};", "", "const uint8_t prpfmt_layout[PRPFMT_SYMBOL_COUNT] = {"]
+    lines += [f"  [{symbol}] = {' | '.join(flags)}," for symbol, _, flags in table if flags]
+    lines += ["};", ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--check", action="store_true", help="fail instead of writing if out of date")
+    args = parser.parse_args()
+
+    header = read(HEADER)
+    parser_c = read(PARSER_C)
+    node_types = json.loads(read(NODE_TYPES))
+
+    problems = check_enum(header, parser_c)
+    if problems:
+        print("ERROR (the symbol enum in prpfmt/prpfmt.h does not match src/parser.c)")
+        for problem in problems[:20]:
+            print(f"  {problem}")
+        sys.exit(1)
+
+    output = generate(node_types, header)
+    if args.check:
+        current = read(OUTPUT) if os.path.exists(OUTPUT) else None
+        if current != output:
+            print("ERROR (prpfmt/prpfmt_dispatch.c is out of date; run prpfmt/gen_dispatch.py)")
+            sys.exit(1)
+        return
+    with open(OUTPUT, "w") as f:
+        f.write(output)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,68 +1,479 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <tree_sitter/api.h>
+#include <unistd.h>
 
 #include "prpfmt.h"
 
+const TSLanguage *tree_sitter_pyrope(void);
+
 void print_help() {
-  printf("Usage: ./prpfmt <input_file> [-o <output_file>]\n");
+  printf("Usage: ./prpfmt <input>... [-o <output_file>] [-i | -d <output_dir>] [-j <threads> | --stream] [--cache <dir>] [--timeout <ms>]\n");
+  printf("       ./prpfmt <input> [--lines <N:M> | --bytes <S:E>] [-o <output_file> | -i]\n");
   printf("       ./prpfmt [-h | --help]\n\n");
+  printf("Inputs are .prp files or directories, which are searched recursively for .prp files.\n");
+  printf("Use - to read from stdin.\n\n");
   printf("Options:\n");
-  printf("  -o <output_file>  Specify an output file. If not provided, output to stdout.\n");
+  printf("  -o <output_file>  Specify an output file (single input only). If not provided, output to stdout.\n");
+  printf("  -i                Format the inputs in place.\n");
+  printf("  -d <output_dir>   Write each formatted file under <output_dir>.\n");
+  printf("  -j <threads>      Number of worker threads. Defaults to the number of CPUs.\n");
+  printf("  --stream          Format each input while it is read, for very large files.\n");
+  printf("  --lines <N:M>     Format only the statements on lines N to M (single input only).\n");
+  printf("  --bytes <S:E>     Format only the statements in bytes [S, E) (single input only).\n");
+  printf("  --cache <dir>     Reuse parse results and output of unchanged inputs from <dir>.\n");
+  printf("  --timeout <ms>    Give up on an input whose parse takes longer than <ms> milliseconds.\n");
   printf("  -h, --help        Display this help message.\n");
 }
 
-char *file_to_string(char *infile) {
-  char *buffer;
-  FILE *fp = fopen(infile, "r");
+// One input file. Workers fill in output/diagnostic; the main thread reports
+// them in input order once every job is done.
+// --lines first:last (1-based, inclusive) or --bytes start:end
+typedef struct {
+  bool enabled;
+  bool lines;
+  uint32_t start;
+  uint32_t end;
+} FormatRange;
 
-  // Attempt to open file
-  if (!fp) {
-    perror(infile);
-    exit(1);
+typedef struct {
+  char *path;
+  char *out_path;
+  const char *cache_dir;
+  PrpfmtParseBudget budget;
+  FormatRange range;
+  PrpfmtSink output;
+  char diagnostic[512];
+  bool failed;
+} FormatJob;
+
+typedef struct {
+  FormatJob *jobs;
+  size_t count;
+  size_t capacity;
+} JobList;
+
+typedef struct {
+  JobList *list;
+  atomic_size_t next;
+} WorkQueue;
+
+static void job_fail(FormatJob *job, const char *message) {
+  snprintf(job->diagnostic, sizeof(job->diagnostic), "Error: %s: %s\n", job->path, message);
+  job->failed = true;
+}
+
+// Create the parent directories of path
+static bool make_parent_dirs(char *path) {
+  for (char *p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+    *p = '\0';
+    bool ok = mkdir(path, 0755) == 0 || errno == EEXIST;
+    *p = '/';
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Open a temporary file next to out_path. Output goes there first so a
+// failed write never truncates the input when formatting in place.
+static int open_output(FormatJob *job, char **tmp_path) {
+  size_t tmp_size = strlen(job->out_path) + sizeof(".prpfmt.tmp");
+  *tmp_path = malloc(tmp_size);
+  if (!*tmp_path) {
+    job_fail(job, "memory allocation failed");
+    return -1;
   }
+  snprintf(*tmp_path, tmp_size, "%s.prpfmt.tmp", job->out_path);
 
-  // Determine file size
-  fseek(fp, 0L, SEEK_END);
-  long l_size = ftell(fp);
-  rewind(fp);
+  int fd = -1;
+  if (!make_parent_dirs(*tmp_path) || (fd = open(*tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+    job_fail(job, strerror(errno));
+    free(*tmp_path);
+    *tmp_path = NULL;
+  }
+  return fd;
+}
 
-  // Allocate memory for file content
-  buffer = malloc(l_size + 1);
-  if (!buffer) {
-    fclose(fp);
-    fprintf(stderr, "Memory allocation failed");
-    exit(1);
+// Close the temporary file and move it over out_path if it was written
+static void finish_output(FormatJob *job, int fd, char *tmp_path, bool written) {
+  if (close(fd) != 0) {
+    written = false;
+  }
+  if (!written || rename(tmp_path, job->out_path) != 0) {
+    if (!job->failed) {
+      job_fail(job, "could not write output file");
+    }
+    unlink(tmp_path);
   }
+  free(tmp_path);
+}
 
-  // Read file content into buffer
-  if (fread(buffer, l_size, 1, fp) != 1) {
-    fclose(fp);
-    free(buffer);
-    fprintf(stderr, "File read failed");
-    exit(1);
+// Write the formatted text to out_path
+static void write_output(FormatJob *job, const PrpfmtSink *formatted) {
+  char *tmp_path;
+  int fd = open_output(job, &tmp_path);
+  if (fd < 0) {
+    return;
+  }
+
+  PrpfmtSink sink;
+  prpfmt_sink_init_fd(&sink, fd);
+  prpfmt_sink_write(&sink, formatted->buffer, formatted->length);
+  finish_output(job, fd, tmp_path, prpfmt_sink_destroy(&sink));
+}
+
+// Write job->output to out_path, or keep it for stdout
+static void deliver_output(FormatJob *job) {
+  if (job->output.failed) {
+    job_fail(job, "formatting failed");
+  } else if (job->out_path) {
+    write_output(job, &job->output);
+  }
+  if (job->out_path || job->failed) {
+    prpfmt_sink_destroy(&job->output);
+  }
+}
+
+// Streaming mode: output is written as the input is read instead of being
+// buffered per job, so jobs run one at a time in input order.
+static void stream_job(TSParser *parser, FormatJob *job, PrpfmtSink *stdout_sink) {
+  int in_fd = STDIN_FILENO;
+  if (strcmp(job->path, "-") != 0 && (in_fd = open(job->path, O_RDONLY)) < 0) {
+    job_fail(job, strerror(errno));
+    return;
+  }
+
+  char *tmp_path = NULL;
+  int out_fd = -1;
+  PrpfmtSink file_sink;
+  PrpfmtSink *out = stdout_sink;
+  if (job->out_path) {
+    out_fd = open_output(job, &tmp_path);
+    if (out_fd < 0) {
+      if (in_fd != STDIN_FILENO) {
+        close(in_fd);
+      }
+      return;
+    }
+    prpfmt_sink_init_fd(&file_sink, out_fd);
+    out = &file_sink;
+  }
+
+  switch (prpfmt_format_stream(parser, in_fd, out, &job->budget)) {
+    case PRPFMT_STREAM_OK:
+      break;
+    case PRPFMT_STREAM_READ_ERROR:
+      job_fail(job, "file read failed");
+      break;
+    case PRPFMT_STREAM_PARSE_ERROR:
+      job_fail(job, "the provided code was unable to be parsed.");
+      break;
+    case PRPFMT_STREAM_WRITE_ERROR:
+      job_fail(job, "could not write output");
+      break;
+    case PRPFMT_STREAM_TIMED_OUT:
+      job_fail(job, prpfmt_parse_status_message(PRPFMT_PARSE_TIMED_OUT));
+      break;
+    case PRPFMT_STREAM_CANCELLED:
+      job_fail(job, prpfmt_parse_status_message(PRPFMT_PARSE_CANCELLED));
+      break;
+  }
+
+  if (in_fd != STDIN_FILENO) {
+    close(in_fd);
+  }
+  if (job->out_path) {
+    bool written = prpfmt_sink_destroy(&file_sink) && !job->failed;
+    finish_output(job, out_fd, tmp_path, written);
+  }
+}
+
+// Format only the selected range; everything around it is copied verbatim.
+// Parse errors elsewhere in the file do not prevent this.
+static void format_range(FormatJob *job, TSTree *tree, const PrpfmtInput *input) {
+  uint32_t start_byte = job->range.start;
+  uint32_t end_byte = job->range.end;
+  if (job->range.lines) {
+    if (!prpfmt_line_range(input->data, input->length, job->range.start, job->range.end, &start_byte, &end_byte)) {
+      job_fail(job, "the line range is outside the file.");
+      return;
+    }
+  } else if (end_byte > input->length || start_byte > end_byte) {
+    job_fail(job, "the byte range is outside the file.");
+    return;
+  }
+
+  PrpfmtDirectiveIndex directives;
+  if (!prpfmt_directives_build(tree, input->data, &directives)) {
+    job_fail(job, "memory allocation failed");
+    return;
+  }
+  PrpfmtTextEdit edit;
+  bool formatted = prpfmt_format_range(tree, input->data, &directives, start_byte, end_byte, &edit);
+  prpfmt_directives_free(&directives);
+  if (!formatted) {
+    job_fail(job, "the selected range does not hold well-formed statements.");
+    return;
+  }
+
+  prpfmt_sink_init_memory(&job->output);
+  prpfmt_sink_write(&job->output, input->data, edit.start_byte);
+  prpfmt_sink_write(&job->output, edit.text, edit.length);
+  prpfmt_sink_write(&job->output, input->data + edit.end_byte, input->length - edit.end_byte);
+  free(edit.text);
+
+  deliver_output(job);
+}
+
+// Answer the job from the cache: an entry with prpfmt output is copied out,
+// and one whose tree has errors fails the job, both without parsing
+static bool format_cached(FormatJob *job, const PrpfmtInput *input) {
+  PrpfmtCacheEntry entry;
+  if (!prpfmt_cache_load(job->cache_dir, tree_sitter_pyrope(), input->data, input->length, &entry)) {
+    return false;
   }
 
-  buffer[l_size] = '\0';
-  fclose(fp);
+  bool answered = true;
+  if (entry.nodes[0].flags & PRPFMT_CACHE_HAS_ERROR) {
+    job_fail(job, "the provided code was unable to be parsed.");
+  } else if (entry.formatted) {
+    prpfmt_sink_init_memory(&job->output);
+    prpfmt_sink_write(&job->output, entry.formatted, entry.formatted_length);
+    deliver_output(job);
+  } else {
+    answered = false;
+  }
+  prpfmt_cache_close(&entry);
+  return answered;
+}
 
-  return buffer;
+// Save tree, and the output if there is one, for the next run. A failed
+// store only costs that run a parse.
+static void cache_tree(FormatJob *job, TSTree *tree, const PrpfmtInput *input, const PrpfmtSink *formatted) {
+  PrpfmtCacheEntry entry;
+  if (!prpfmt_cache_build(tree, &entry)) {
+    return;
+  }
+  if (formatted && !formatted->failed && formatted->length <= UINT32_MAX) {
+    entry.formatted = formatted->buffer;
+    entry.formatted_length = (uint32_t)formatted->length;
+  }
+  prpfmt_cache_store(job->cache_dir, tree_sitter_pyrope(), input->data, input->length, &entry);
+  prpfmt_cache_close(&entry);
 }
 
-void cleanup(char *source_code, TSTree *tree, TSParser *parser, FILE *outfile) {
-  // Free any allocated memory
-  if (source_code) {
-    free(source_code);
+static void format_job(TSParser *parser, FormatJob *job) {
+  PrpfmtInput input;
+  int error = prpfmt_input_open(&input, job->path);
+  if (error) {
+    job_fail(job, strerror(error));
+    return;
+  }
+
+  if (job->cache_dir && !job->range.enabled && format_cached(job, &input)) {
+    prpfmt_input_close(&input);
+    return;
+  }
+
+  // The budget covers the parse only; a cache hit above never starts it
+  PrpfmtParseStatus parse_status;
+  prpfmt_budget_start(&job->budget);
+  TSTree *tree = prpfmt_parse_string(parser, NULL, input.data, input.length, &job->budget, &parse_status);
+  if (!tree) {
+    job_fail(job, prpfmt_parse_status_message(parse_status));
+    prpfmt_input_close(&input);
+    return;
   }
-  if (tree) {
+
+  if (job->range.enabled) {
+    format_range(job, tree, &input);
     ts_tree_delete(tree);
+    prpfmt_input_close(&input);
+    return;
   }
-  if (parser) {
-    ts_parser_delete(parser);
+
+  // Check if tree has any ERROR or MISSING nodes
+  if (ts_node_has_error(ts_tree_root_node(tree))) {
+    job_fail(job, "the provided code was unable to be parsed.");
+    if (job->cache_dir) {
+      cache_tree(job, tree, &input, NULL);
+    }
+    ts_tree_delete(tree);
+    prpfmt_input_close(&input);
+    return;
+  }
+
+  // Initialize state
+  prpfmt_sink_init_memory(&job->output);
+
+  PrpfmtState state = {
+    .source_code = input.data,
+    .out = &job->output,
+    .indent_level = 0,
+    .indent_size = 2,
+    .fmt_on = true
+  };
+
+  print_tree(tree, &state);
+  if (job->cache_dir) {
+    cache_tree(job, tree, &input, &job->output);
+  }
+  ts_tree_delete(tree);
+  prpfmt_input_close(&input);
+
+  deliver_output(job);
+}
+
+// Worker thread: owns one parser and pulls jobs until the queue is empty
+static void *format_worker(void *arg) {
+  WorkQueue *queue = arg;
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_pyrope());
+
+  for (;;) {
+    size_t index = atomic_fetch_add(&queue->next, 1);
+    if (index >= queue->list->count) {
+      break;
+    }
+    format_job(parser, &queue->list->jobs[index]);
+    ts_parser_reset(parser);
+  }
+
+  ts_parser_delete(parser);
+  return NULL;
+}
+
+static void add_job(JobList *list, const char *path, const char *out_path) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 64;
+    list->jobs = realloc(list->jobs, list->capacity * sizeof(FormatJob));
+    if (!list->jobs) {
+      fprintf(stderr, "Memory allocation failed");
+      exit(1);
+    }
+  }
+  FormatJob *job = &list->jobs[list->count++];
+  memset(job, 0, sizeof(*job));
+  job->path = strdup(path);
+  job->out_path = out_path ? strdup(out_path) : NULL;
+}
+
+static bool has_prp_extension(const char *name) {
+  size_t len = strlen(name);
+  return len > 4 && strcmp(name + len - 4, ".prp") == 0;
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Collect .prp files under dir (relative to root) in sorted order, so that
+// job order and therefore diagnostics order never depend on readdir
+static void collect_dir(JobList *list, const char *dir, size_t root_len, const char *out_dir) {
+  DIR *d = opendir(dir);
+  if (!d) {
+    perror(dir);
+    exit(1);
+  }
+
+  char **names = NULL;
+  size_t count = 0;
+  size_t capacity = 0;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 32;
+      names = realloc(names, capacity * sizeof(char *));
+      if (!names) {
+        fprintf(stderr, "Memory allocation failed");
+        exit(1);
+      }
+    }
+    names[count++] = strdup(entry->d_name);
+  }
+  closedir(d);
+  qsort(names, count, sizeof(char *), compare_strings);
+
+  for (size_t i = 0; i < count; i++) {
+    size_t path_size = strlen(dir) + strlen(names[i]) + 2;
+    char *path = malloc(path_size);
+    snprintf(path, path_size, "%s/%s", dir, names[i]);
+
+    struct stat sb;
+    if (stat(path, &sb) == 0) {
+      if (S_ISDIR(sb.st_mode)) {
+        collect_dir(list, path, root_len, out_dir);
+      } else if (S_ISREG(sb.st_mode) && has_prp_extension(names[i])) {
+        char *out_path = NULL;
+        if (out_dir) {
+          size_t out_size = strlen(out_dir) + strlen(path + root_len) + 2;
+          out_path = malloc(out_size);
+          snprintf(out_path, out_size, "%s/%s", out_dir, path + root_len + 1);
+        }
+        add_job(list, path, out_path);
+        free(out_path);
+      }
+    }
+    free(path);
+    free(names[i]);
+  }
+  free(names);
+}
+
+static void collect_input(JobList *list, const char *input, const char *out_dir, bool in_place) {
+  // "-" reads the source from stdin
+  if (strcmp(input, "-") == 0) {
+    if (in_place || out_dir) {
+      fprintf(stderr, "Error: stdin cannot be formatted with -i or -d.\n");
+      exit(1);
+    }
+    add_job(list, input, NULL);
+    return;
   }
-  if (outfile && outfile != stdout) {
-    fclose(outfile);
+
+  struct stat sb;
+  if (stat(input, &sb) != 0) {
+    perror(input);
+    exit(1);
+  }
+
+  if (S_ISDIR(sb.st_mode)) {
+    size_t first = list->count;
+    collect_dir(list, input, strlen(input), out_dir);
+    if (in_place) {
+      for (size_t i = first; i < list->count; i++) {
+        list->jobs[i].out_path = strdup(list->jobs[i].path);
+      }
+    }
+    return;
+  }
+
+  if (in_place) {
+    add_job(list, input, input);
+  } else if (out_dir) {
+    const char *base = strrchr(input, '/');
+    base = base ? base + 1 : input;
+    size_t out_size = strlen(out_dir) + strlen(base) + 2;
+    char *out_path = malloc(out_size);
+    snprintf(out_path, out_size, "%s/%s", out_dir, base);
+    add_job(list, input, out_path);
+    free(out_path);
+  } else {
+    add_job(list, input, NULL);
   }
 }
 
@@ -74,81 +485,182 @@ int main(int argc, char **argv) {
     exit(1);
   }
 
-  // Parse for -h option
-  if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
-    print_help();
-    return 0;
-  }
-  
-  char *infile_path = argv[1];
   char *outfile_path = NULL;
+  char *out_dir = NULL;
+  char *cache_dir = NULL;
+  uint64_t timeout_micros = 0;
+  bool in_place = false;
+  FormatRange range = {0};
+  bool stream = false;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  char **inputs = calloc(argc, sizeof(char *));
+  int input_count = 0;
 
-  // Parse for -o option
-  for (int i = 2; i < argc; i++) {
-    if (strcmp(argv[i], "-o") == 0) {
-      if (i + 1 < argc) {
+  // Parse options; everything else is an input
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      print_help();
+      return 0;
+    } else if (strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "-j") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Error: %s requires an argument.\n", argv[i]);
+        print_help();
+        exit(1);
+      }
+      if (argv[i][1] == 'o') {
         outfile_path = argv[i + 1];
-        i++;
+      } else if (argv[i][1] == 'd') {
+        out_dir = argv[i + 1];
       } else {
-        fprintf(stderr, "Error: -o requires an output file path.\n");
+        threads = strtol(argv[i + 1], NULL, 10);
+      }
+      i++;
+    } else if (strcmp(argv[i], "--lines") == 0 || strcmp(argv[i], "--bytes") == 0) {
+      unsigned long start, end;
+      char trailing;
+      if (i + 1 >= argc || sscanf(argv[i + 1], "%lu:%lu%c", &start, &end, &trailing) != 2 ||
+          end > UINT32_MAX || start > end) {
+        fprintf(stderr, "Error: %s requires a range of the form start:end.\n", argv[i]);
         print_help();
         exit(1);
       }
-    } else {
+      range = (FormatRange){true, argv[i][2] == 'l', (uint32_t)start, (uint32_t)end};
+      i++;
+    } else if (strcmp(argv[i], "--cache") == 0) {
+      if (i + 1 >= argc) {
+        fprintf(stderr, "Error: %s requires an argument.\n", argv[i]);
+        print_help();
+        exit(1);
+      }
+      cache_dir = argv[++i];
+    } else if (strcmp(argv[i], "--timeout") == 0) {
+      char *end;
+      unsigned long long ms = i + 1 < argc ? strtoull(argv[i + 1], &end, 10) : 0;
+      if (i + 1 >= argc || *end != '\0' || ms == 0) {
+        fprintf(stderr, "Error: %s requires a positive number of milliseconds.\n", argv[i]);
+        print_help();
+        exit(1);
+      }
+      timeout_micros = ms * 1000;
+      i++;
+    } else if (strcmp(argv[i], "--stream") == 0) {
+      stream = true;
+    } else if (strcmp(argv[i], "-i") == 0) {
+      in_place = true;
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
       fprintf(stderr, "Error: Invalid argument '%s'.\n", argv[i]);
       print_help();
       exit(1);
+    } else {
+      inputs[input_count++] = argv[i];
     }
   }
-  
-  // Set output file
-  FILE *outfile = stdout;
-  if (outfile_path) {
-    outfile = fopen(outfile_path, "w");
-    if (!outfile) {
-      perror("Error opening output file");
-      exit(1);
-    }
+
+  if (input_count == 0) {
+    fprintf(stderr, "Error: Input file path is required.\n");
+    print_help();
+    exit(1);
+  }
+  if ((in_place && out_dir) || (outfile_path && (in_place || out_dir))) {
+    fprintf(stderr, "Error: -o, -i and -d are mutually exclusive.\n");
+    exit(1);
+  }
+  if (stream && range.enabled) {
+    fprintf(stderr, "Error: --stream cannot be combined with --lines or --bytes.\n");
+    exit(1);
+  }
+  if (stream && cache_dir) {
+    fprintf(stderr, "Error: --stream cannot be combined with --cache.\n");
+    exit(1);
+  }
+  if (threads < 1) {
+    threads = 1;
   }
 
-  // Tree-sitter parser initialization
-  TSLanguage *tree_sitter_pyrope();
+  // Tree-sitter language check
   TSParser *parser = ts_parser_new();
   if (!ts_parser_set_language(parser, tree_sitter_pyrope())) {
     fprintf(stderr, "Error: the language was generated with an "
                     "incompatible version of the tree-sitter CLI.\n");
-    cleanup(NULL, NULL, parser, outfile);
+    ts_parser_delete(parser);
     exit(1);
   }
+  prpfmt_init(tree_sitter_pyrope());
 
-  // Parse the source code
-  char *source_code = file_to_string(infile_path);
-  TSTree *tree =
-      ts_parser_parse_string(parser, NULL, source_code, strlen(source_code));
-
-  // Check if tree has any ERROR or MISSING nodes
-  TSNode root = ts_tree_root_node(tree);
-
-  if (ts_node_has_error(root)) {
-    fprintf(stderr, "Error: the provided code was unable to be parsed.\n");
-    cleanup(source_code, tree, parser, outfile);
-    exit(1);
+  JobList list = {0};
+  for (int i = 0; i < input_count; i++) {
+    collect_input(&list, inputs[i], out_dir, in_place);
+  }
+  free(inputs);
+  for (size_t i = 0; i < list.count; i++) {
+    list.jobs[i].cache_dir = cache_dir;
+    list.jobs[i].budget.timeout_micros = timeout_micros;
   }
 
-  // Initialize state
-  PrpfmtState state = {
-    .source_code = source_code,
-    .outfile = outfile,
-    .indent_level = 0,
-    .indent_size = 2,
-    .fmt_on = true
-  };
+  if (outfile_path) {
+    if (list.count != 1) {
+      fprintf(stderr, "Error: -o requires exactly one input file.\n");
+      exit(1);
+    }
+    list.jobs[0].out_path = strdup(outfile_path);
+  }
+  if (range.enabled) {
+    if (list.count != 1 || out_dir) {
+      fprintf(stderr, "Error: --lines and --bytes require exactly one input file.\n");
+      exit(1);
+    }
+    list.jobs[0].range = range;
+  }
 
-  // test_print_all_nodes(tree, source_code);
-  print_tree(tree, &state);
+  // Stream on the main thread, or format there or on a pool of workers that
+  // each own a parser
+  WorkQueue queue = {.list = &list};
+  atomic_init(&queue.next, 0);
+  if (threads > (long)list.count) {
+    threads = (long)list.count;
+  }
+  PrpfmtSink stdout_sink;
+  prpfmt_sink_init_fd(&stdout_sink, STDOUT_FILENO);
+  if (stream) {
+    for (size_t i = 0; i < list.count; i++) {
+      stream_job(parser, &list.jobs[i], &stdout_sink);
+      ts_parser_reset(parser);
+    }
+  } else if (threads <= 1) {
+    for (size_t i = 0; i < list.count; i++) {
+      format_job(parser, &list.jobs[i]);
+      ts_parser_reset(parser);
+    }
+  } else {
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    for (long i = 0; i < threads; i++) {
+      pthread_create(&workers[i], NULL, format_worker, &queue);
+    }
+    for (long i = 0; i < threads; i++) {
+      pthread_join(workers[i], NULL);
+    }
+    free(workers);
+  }
+  ts_parser_delete(parser);
 
-  // Free memory
-  cleanup(source_code, tree, parser, outfile);
+  // Report results in input order
+  int status = 0;
+  for (size_t i = 0; i < list.count; i++) {
+    FormatJob *job = &list.jobs[i];
+    if (job->failed) {
+      fputs(job->diagnostic, stderr);
+      status = 1;
+    } else if (!job->out_path && !stream) {
+      prpfmt_sink_write(&stdout_sink, job->output.buffer, job->output.length);
+      prpfmt_sink_destroy(&job->output);
+    }
+    free(job->path);
+    free(job->out_path);
+  }
+  if (!prpfmt_sink_destroy(&stdout_sink)) {
+    status = 1;
+  }
+  free(list.jobs);
 
-  return 0;
+  return status;
 }
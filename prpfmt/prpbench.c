@@ -0,0 +1,376 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+// Benchmark for the parser and prpfmt. Each corpus directory is turned into
+// one source by concatenating its .prp files that parse cleanly, then
+// repeated at each scale. Results are written as JSON.
+//
+// Every (corpus, scale) entry runs in a child process of its own, so its
+// peak RSS is that entry's high-water mark, plus the few MB the parent holds
+// when it forks, and not the largest entry run so far.
+
+#define DEFAULT_ITERATIONS 5
+
+static const unsigned default_scales[] = {1, 4, 16, 64};
+
+void print_help() {
+  printf("Usage: ./prpbench [--iterations <n>] [--scales <a,b,...>] [--json <output_file>] <corpus_dir>...\n\n");
+  printf("Options:\n");
+  printf("  --iterations <n>   Timed runs per phase. Defaults to %d.\n", DEFAULT_ITERATIONS);
+  printf("  --scales <list>    Comma-separated repeat counts of each corpus. Defaults to 1,4,16,64.\n");
+  printf("  --json <file>      Write results to <file>. If not provided, output to stdout.\n");
+}
+
+// Allocation counters for the tree-sitter runtime, installed with
+// ts_set_allocator
+static atomic_size_t alloc_count;
+static atomic_size_t alloc_bytes;
+
+static void *counting_malloc(size_t size) {
+  atomic_fetch_add(&alloc_count, 1);
+  atomic_fetch_add(&alloc_bytes, size);
+  return malloc(size);
+}
+
+static void *counting_calloc(size_t count, size_t size) {
+  atomic_fetch_add(&alloc_count, 1);
+  atomic_fetch_add(&alloc_bytes, count * size);
+  return calloc(count, size);
+}
+
+static void *counting_realloc(void *ptr, size_t size) {
+  atomic_fetch_add(&alloc_count, 1);
+  atomic_fetch_add(&alloc_bytes, size);
+  return realloc(ptr, size);
+}
+
+typedef struct {
+  size_t count;
+  size_t bytes;
+} AllocSnapshot;
+
+static AllocSnapshot alloc_snapshot(void) {
+  return (AllocSnapshot){atomic_load(&alloc_count), atomic_load(&alloc_bytes)};
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// High-water RSS of this process; called in the child that runs one entry
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+typedef struct {
+  double min;
+  double total;
+  double *samples;
+  unsigned count;
+} PhaseTime;
+
+static void phase_record(PhaseTime *phase, double seconds) {
+  if (phase->count == 0 || seconds < phase->min) {
+    phase->min = seconds;
+  }
+  phase->total += seconds;
+  phase->samples[phase->count++] = seconds;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Median of the recorded runs; less sensitive to a noisy machine than the
+// mean, which is what the regression gate compares
+static double phase_median(PhaseTime *phase) {
+  qsort(phase->samples, phase->count, sizeof(double), compare_doubles);
+  if (phase->count % 2 == 1) {
+    return phase->samples[phase->count / 2];
+  }
+  return (phase->samples[phase->count / 2 - 1] + phase->samples[phase->count / 2]) / 2;
+}
+
+typedef struct {
+  char *data;
+  size_t length;
+  unsigned files;
+  unsigned skipped;
+} Corpus;
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void corpus_append(Corpus *corpus, const char *data, size_t length) {
+  char *grown = realloc(corpus->data, corpus->length + length + 1);
+  if (!grown) {
+    fprintf(stderr, "Memory allocation failed");
+    exit(1);
+  }
+  corpus->data = grown;
+  memcpy(corpus->data + corpus->length, data, length);
+  corpus->length += length;
+  corpus->data[corpus->length] = '\0';
+}
+
+// Collect the .prp files of dir, in sorted order, that parse without errors.
+// Files that do not parse are counted but left out so every scale can also
+// be formatted.
+static Corpus load_corpus(TSParser *parser, const char *dir) {
+  Corpus corpus = {0};
+  DIR *d = opendir(dir);
+  if (!d) {
+    perror(dir);
+    exit(1);
+  }
+
+  char **names = NULL;
+  size_t count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    size_t len = strlen(entry->d_name);
+    if (len > 4 && strcmp(entry->d_name + len - 4, ".prp") == 0) {
+      names = realloc(names, (count + 1) * sizeof(char *));
+      names[count++] = strdup(entry->d_name);
+    }
+  }
+  closedir(d);
+  qsort(names, count, sizeof(char *), compare_strings);
+
+  for (size_t i = 0; i < count; i++) {
+    size_t path_size = strlen(dir) + strlen(names[i]) + 2;
+    char *path = malloc(path_size);
+    snprintf(path, path_size, "%s/%s", dir, names[i]);
+
+    PrpfmtInput input;
+    if (prpfmt_input_open(&input, path) == 0) {
+      TSTree *tree = ts_parser_parse_string(parser, NULL, input.data, input.length);
+      if (ts_node_has_error(ts_tree_root_node(tree))) {
+        corpus.skipped++;
+      } else {
+        char header[512];
+        int header_length = snprintf(header, sizeof(header), "// %s\n", names[i]);
+        corpus_append(&corpus, header, (size_t)header_length);
+        corpus_append(&corpus, input.data, input.length);
+        if (input.length > 0 && input.data[input.length - 1] != '\n') {
+          corpus_append(&corpus, "\n", 1);
+        }
+        corpus.files++;
+      }
+      ts_tree_delete(tree);
+      prpfmt_input_close(&input);
+    } else {
+      corpus.skipped++;
+    }
+    free(path);
+    free(names[i]);
+  }
+  free(names);
+  return corpus;
+}
+
+static void json_string(FILE *out, const char *text) {
+  fputc('"', out);
+  for (const char *p = text; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      fputc('\\', out);
+    }
+    fputc(*p, out);
+  }
+  fputc('"', out);
+}
+
+// Time parsing and formatting of one scaled corpus and print a JSON object
+static void bench_source(FILE *out, TSParser *parser, const char *name, unsigned scale,
+                         const char *source, size_t length, unsigned iterations) {
+  PhaseTime parse = {.samples = malloc(iterations * sizeof(double))};
+  PhaseTime format = {.samples = malloc(iterations * sizeof(double))};
+  if (!parse.samples || !format.samples) {
+    fprintf(stderr, "Memory allocation failed");
+    exit(1);
+  }
+  AllocSnapshot parse_allocs = {0};
+  size_t formatted_length = 0;
+
+  for (unsigned i = 0; i < iterations; i++) {
+    AllocSnapshot before = alloc_snapshot();
+    double start = now_seconds();
+    TSTree *tree = ts_parser_parse_string(parser, NULL, source, (uint32_t)length);
+    phase_record(&parse, now_seconds() - start);
+    AllocSnapshot after = alloc_snapshot();
+    parse_allocs = (AllocSnapshot){after.count - before.count, after.bytes - before.bytes};
+
+    PrpfmtSink sink;
+    prpfmt_sink_init_memory(&sink);
+    PrpfmtState state = {
+      .source_code = source,
+      .out = &sink,
+      .indent_level = 0,
+      .indent_size = 2,
+      .fmt_on = true
+    };
+    start = now_seconds();
+    print_tree(tree, &state);
+    phase_record(&format, now_seconds() - start);
+    formatted_length = sink.length;
+
+    prpfmt_sink_destroy(&sink);
+    ts_tree_delete(tree);
+    ts_parser_reset(parser);
+  }
+
+  double mb = (double)length / (1024.0 * 1024.0);
+  fprintf(out, "    {\"corpus\": ");
+  json_string(out, name);
+  fprintf(out, ", \"scale\": %u, \"bytes\": %zu, \"formatted_bytes\": %zu, \"iterations\": %u,\n",
+          scale, length, formatted_length, iterations);
+  double parse_median = phase_median(&parse);
+  double format_median = phase_median(&format);
+  fprintf(out, "     \"parse\": {\"min_s\": %.6f, \"mean_s\": %.6f, \"median_s\": %.6f, \"mb_per_s\": %.2f, "
+               "\"median_mb_per_s\": %.2f, \"allocations\": %zu, \"allocated_bytes\": %zu},\n",
+          parse.min, parse.total / iterations, parse_median, mb / parse.min, mb / parse_median,
+          parse_allocs.count, parse_allocs.bytes);
+  fprintf(out, "     \"format\": {\"min_s\": %.6f, \"mean_s\": %.6f, \"median_s\": %.6f, \"mb_per_s\": %.2f, "
+               "\"median_mb_per_s\": %.2f},\n",
+          format.min, format.total / iterations, format_median, mb / format.min, mb / format_median);
+  fprintf(out, "     \"peak_rss_kb\": %ld}", peak_rss_kb());
+  free(parse.samples);
+  free(format.samples);
+}
+
+int main(int argc, char **argv) {
+  unsigned iterations = DEFAULT_ITERATIONS;
+  unsigned scales[32];
+  size_t scale_count = sizeof(default_scales) / sizeof(default_scales[0]);
+  memcpy(scales, default_scales, sizeof(default_scales));
+  const char *json_path = NULL;
+  char **dirs = calloc(argc, sizeof(char *));
+  int dir_count = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      print_help();
+      return 0;
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = (unsigned)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--scales") == 0 && i + 1 < argc) {
+      scale_count = 0;
+      for (char *p = argv[++i]; *p && scale_count < 32; p++) {
+        unsigned long scale = strtoul(p, &p, 10);
+        if (scale > 0) {
+          scales[scale_count++] = (unsigned)scale;
+        }
+        if (*p != ',') {
+          break;
+        }
+      }
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Error: Invalid argument '%s'.\n", argv[i]);
+      print_help();
+      exit(1);
+    } else {
+      dirs[dir_count++] = argv[i];
+    }
+  }
+
+  if (dir_count == 0 || iterations == 0 || scale_count == 0) {
+    print_help();
+    exit(1);
+  }
+
+  FILE *out = stdout;
+  if (json_path && !(out = fopen(json_path, "w"))) {
+    perror(json_path);
+    exit(1);
+  }
+
+  ts_set_allocator(counting_malloc, counting_calloc, counting_realloc, free);
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, tree_sitter_pyrope())) {
+    fprintf(stderr, "Error: the language was generated with an "
+                    "incompatible version of the tree-sitter CLI.\n");
+    exit(1);
+  }
+  prpfmt_init(tree_sitter_pyrope());
+
+  fprintf(out, "{\n  \"results\": [\n");
+  bool first = true;
+  for (int d = 0; d < dir_count; d++) {
+    Corpus corpus = load_corpus(parser, dirs[d]);
+    fprintf(stderr, "%s: %u files, %u skipped, %zu bytes\n", dirs[d], corpus.files, corpus.skipped, corpus.length);
+    if (corpus.length == 0) {
+      free(corpus.data);
+      continue;
+    }
+
+    for (size_t s = 0; s < scale_count; s++) {
+      size_t length = corpus.length * scales[s];
+      if (length > UINT32_MAX) {
+        break;
+      }
+
+      if (!first) {
+        fprintf(out, ",\n");
+      }
+      first = false;
+      fflush(out);
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("fork");
+        exit(1);
+      }
+      if (pid == 0) {
+        char *source = malloc(length);
+        if (!source) {
+          fprintf(stderr, "Memory allocation failed");
+          _exit(1);
+        }
+        for (unsigned k = 0; k < scales[s]; k++) {
+          memcpy(source + k * corpus.length, corpus.data, corpus.length);
+        }
+        bench_source(out, parser, dirs[d], scales[s], source, length, iterations);
+        fflush(out);
+        _exit(ferror(out) ? 1 : 0);
+      }
+
+      int status;
+      if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Error: the benchmark of %s x%u failed\n", dirs[d], scales[s]);
+        exit(1);
+      }
+    }
+    free(corpus.data);
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  ts_parser_delete(parser);
+  free(dirs);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -5,34 +5,207 @@
 
 #include "prpfmt.h"
 
+static const char indent_spaces[] =
+    "                                                                "
+    "                                                                ";
+
 void print_indent(PrpfmtState *st) {
-  for (int i = 0; i < st->indent_level * st->indent_size; i++) {
-    fprintf(st->outfile, " ");
+  int width = st->indent_level * st->indent_size;
+  while (width > 0) {
+    int chunk = width < (int)sizeof(indent_spaces) - 1 ? width : (int)sizeof(indent_spaces) - 1;
+    print_slice(indent_spaces, chunk, st);
+    width -= chunk;
   }
 }
 
-void check_format_directives(const char *node_text, PrpfmtState *st) {
-  if (strstr(node_text, "prpfmt off")) {
+void print_node_text(TSNode node, PrpfmtState *st) {
+  uint32_t start_byte = ts_node_start_byte(node);
+  uint32_t end_byte = ts_node_end_byte(node);
+  print_slice(st->source_code + start_byte, end_byte - start_byte, st);
+}
+
+bool node_text_equals(TSNode node, const char *text, PrpfmtState *st) {
+  uint32_t start_byte = ts_node_start_byte(node);
+  uint32_t length = ts_node_end_byte(node) - start_byte;
+  return strlen(text) == length && memcmp(st->source_code + start_byte, text, length) == 0;
+}
+
+static bool node_text_contains(TSNode node, const char *needle, PrpfmtState *st) {
+  const char *text = st->source_code + ts_node_start_byte(node);
+  uint32_t length = ts_node_end_byte(node) - ts_node_start_byte(node);
+  size_t needle_length = strlen(needle);
+
+  for (uint32_t i = 0; i + needle_length <= length; i++) {
+    if (memcmp(text + i, needle, needle_length) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void check_format_directives(TSNode node, PrpfmtState *st) {
+  if (node_text_contains(node, "prpfmt off", st)) {
     st->fmt_on = false;
-  } else if (strstr(node_text, "prpfmt on")) {
+  } else if (node_text_contains(node, "prpfmt on", st)) {
     st->fmt_on = true;
   }
 }
 
+// Print node with its printer from prpfmt_printers; a token without one is
+// copied as written
+static void print_node(TSNode node, PrpfmtState *st) {
+  PrpfmtPrinter printer = prpfmt_printer(ts_node_grammar_symbol(node));
+  if (printer) {
+    printer(node, st);
+  } else if (ts_node_child_count(node) == 0) {
+    print_node_text(node, st);
+  }
+}
+
+// Field ids, resolved by prpfmt_init()
+TSFieldId field_alias;
+TSFieldId field_args;
+TSFieldId field_argument;
+TSFieldId field_attribute;
+TSFieldId field_attributes;
+TSFieldId field_base;
+TSFieldId field_body;
+TSFieldId field_capture;
+TSFieldId field_code;
+TSFieldId field_condition;
+TSFieldId field_constrained;
+TSFieldId field_data;
+TSFieldId field_decl;
+TSFieldId field_definition;
+TSFieldId field_delay;
+TSFieldId field_func_type;
+TSFieldId field_function;
+TSFieldId field_generic;
+TSFieldId field_identifier;
+TSFieldId field_implementation;
+TSFieldId field_index;
+TSFieldId field_init;
+TSFieldId field_input;
+TSFieldId field_left;
+TSFieldId field_length;
+TSFieldId field_lvalue;
+TSFieldId field_match_list;
+TSFieldId field_mod;
+TSFieldId field_module;
+TSFieldId field_name;
+TSFieldId field_operator;
+TSFieldId field_output;
+TSFieldId field_pipe_config;
+TSFieldId field_right;
+TSFieldId field_rvalue;
+TSFieldId field_select;
+TSFieldId field_timing;
+TSFieldId field_trait_name;
+TSFieldId field_type;
+TSFieldId field_type_name;
+TSFieldId field_values;
+TSFieldId field_verification;
+
+static const TSNode null_node;
+
+TSNode cursor_first_child(PrpfmtState *st) {
+  st->prev_sibling = null_node;
+  if (!ts_tree_cursor_goto_first_child(&st->cursor)) {
+    return null_node;
+  }
+  return ts_tree_cursor_current_node(&st->cursor);
+}
+
+TSNode cursor_next_sibling(PrpfmtState *st) {
+  st->prev_sibling = ts_tree_cursor_current_node(&st->cursor);
+  if (!ts_tree_cursor_goto_next_sibling(&st->cursor)) {
+    ts_tree_cursor_goto_parent(&st->cursor);
+    return null_node;
+  }
+  return ts_tree_cursor_current_node(&st->cursor);
+}
+
+TSNode cursor_peek_next_sibling(PrpfmtState *st) {
+  ts_tree_cursor_reset_to(&st->lookahead, &st->cursor);
+  if (!ts_tree_cursor_goto_next_sibling(&st->lookahead)) {
+    return null_node;
+  }
+  return ts_tree_cursor_current_node(&st->lookahead);
+}
+
+void prpfmt_init(const TSLanguage *language) {
+  static const struct {
+    const char *name;
+    TSFieldId *id;
+  } fields[] = {
+    {"alias", &field_alias},
+    {"args", &field_args},
+    {"argument", &field_argument},
+    {"attribute", &field_attribute},
+    {"attributes", &field_attributes},
+    {"base", &field_base},
+    {"body", &field_body},
+    {"capture", &field_capture},
+    {"code", &field_code},
+    {"condition", &field_condition},
+    {"constrained", &field_constrained},
+    {"data", &field_data},
+    {"decl", &field_decl},
+    {"definition", &field_definition},
+    {"delay", &field_delay},
+    {"func_type", &field_func_type},
+    {"function", &field_function},
+    {"generic", &field_generic},
+    {"identifier", &field_identifier},
+    {"implementation", &field_implementation},
+    {"index", &field_index},
+    {"init", &field_init},
+    {"input", &field_input},
+    {"left", &field_left},
+    {"length", &field_length},
+    {"lvalue", &field_lvalue},
+    {"match_list", &field_match_list},
+    {"mod", &field_mod},
+    {"module", &field_module},
+    {"name", &field_name},
+    {"operator", &field_operator},
+    {"output", &field_output},
+    {"pipe_config", &field_pipe_config},
+    {"right", &field_right},
+    {"rvalue", &field_rvalue},
+    {"select", &field_select},
+    {"timing", &field_timing},
+    {"trait_name", &field_trait_name},
+    {"type", &field_type},
+    {"type_name", &field_type_name},
+    {"values", &field_values},
+    {"verification", &field_verification},
+  };
+
+  // A field the generated parser does not know (e.g. verification, on the
+  // unreachable function_definition rule) gets an id no child can carry
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    TSFieldId id = ts_language_field_id_for_name(language, fields[i].name, strlen(fields[i].name));
+    *fields[i].id = id ? id : PRPFMT_NO_FIELD;
+  }
+}
+
 void print_tree(TSTree *tree, PrpfmtState *st) {
-  // Get root and child info
   TSNode root_node = ts_tree_root_node(tree);
-  uint32_t root_child_count = ts_node_child_count(root_node);
+  st->cursor = ts_tree_cursor_new(root_node);
+  st->lookahead = ts_tree_cursor_new(root_node);
 
   // Iterate over the root's children
-  for (uint32_t i = 0; i < root_child_count; i++) {
-    TSNode child = ts_node_child(root_node, i);
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     print_statement(child, st);
   }
+
+  ts_tree_cursor_delete(&st->lookahead);
+  ts_tree_cursor_delete(&st->cursor);
 }
 
 void print_comment(TSNode node, PrpfmtState *st) {
-  TSNode prev = ts_node_prev_sibling(node);
+  TSNode prev = st->prev_sibling;
   if (ts_node_is_null(prev)) {
     print_comment_newline(node, st);
     return;
@@ -49,25 +222,19 @@ void print_comment(TSNode node, PrpfmtState *st) {
 }
 
 void print_comment_inline(TSNode node, PrpfmtState *st) {
-  char *node_text = get_node_text(node, st->source_code);
-  if (node_text) {
-    check_format_directives(node_text, st);
-    fprintf(st->outfile, " %s", node_text);
-    if (!ts_node_is_null(ts_node_next_sibling(node))) {
-      fprintf(st->outfile, "\n");
-    }
-    free(node_text);
+  check_format_directives(node, st);
+  print_literal(" ", st);
+  print_node_text(node, st);
+  if (!ts_node_is_null(cursor_peek_next_sibling(st))) {
+    print_literal("\n", st);
   }
 }
 
 void print_comment_newline(TSNode node, PrpfmtState *st) {
-  char *node_text = get_node_text(node, st->source_code);
-  if (node_text) {
-    check_format_directives(node_text, st);
-    print_indent(st);
-    fprintf(st->outfile, "%s\n", node_text);
-    free(node_text);
-  }
+  check_format_directives(node, st);
+  print_indent(st);
+  print_node_text(node, st);
+  print_literal("\n", st);
 }
 
 void print_statement(TSNode node, PrpfmtState *st) {
@@ -76,78 +243,32 @@ void print_statement(TSNode node, PrpfmtState *st) {
     return;
   }
 
-  if (!st->fmt_on) {
-    char *node_text = get_node_text(node, st->source_code);
-    if (node_text) {
-      print_indent(st);
-      fprintf(st->outfile, "%s\n", node_text);
-      free(node_text);
-    }
+  if (!st->fmt_on || st->nesting >= PRPFMT_MAX_NESTING) {
+    print_indent(st);
+    print_node_text(node, st);
+    print_literal("\n", st);
     return;
   }
+  st->nesting++;
 
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  bool first = true;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
+    uint8_t layout = prpfmt_symbol_layout(symbol);
 
-    if (i == 0 && symbol != sym_scope_statement) {
+    if (first && !(layout & PRPFMT_LAYOUT_OWN_INDENT)) {
       print_indent(st);
     }
+    first = false;
 
-    switch (symbol) {
-      case sym_assignment_or_declaration_statement:
-        print_assignment_or_declaration_statement(child, st);
-        break;
-      case sym_control_statement:
-        print_control_statement(child, st);
-        break;
-      case sym_declaration_statement:
-        print_declaration_statement(child, st);
-        break;
-      case sym_enum_assignment_statement:
-        print_enum_assignment_statement(child, st);
-        break;
-      case sym_expression_statement:
-        print_expression_statement(child, st);
-        break;
-      case sym_for_statement:
-        print_for_statement(child, st);
-        break;
-      case sym_function_call_statement:
-        print_function_call_statement(child, st);
-        break;
-      case sym_impl_statement:
-        print_impl_statement(child, st);
-        break;
-      case sym_import_statement:
-        print_import_statement(child, st);
-        break;
-      case sym_lambda:
-        print_lambda(child, st);
-        break;
-      case sym_loop_statement:
-        print_loop_statement(child, st);
-        break;
-      case sym_scope_statement:
-        print_scope_statement(child, st);
-        break;
-      case sym_test_statement:
-        print_test_statement(child, st);
-        break;
-      case sym_type_statement:
-        print_type_statement(child, st);
-        break;
-      case sym_while_statement:
-        print_while_statement(child, st);
-        break;
-      case sym_comment:
-        print_comment(child, st);
-        break;
+    if (layout & (PRPFMT_LAYOUT_STATEMENT | PRPFMT_LAYOUT_EXTRA)) {
+      prpfmt_printers[symbol](child, st);
     }
   }
 
-  TSNode next = ts_node_next_sibling(node);
+  st->nesting--;
+
+  TSNode next = cursor_peek_next_sibling(st);
   if (!ts_node_is_null(next) && ts_node_grammar_symbol(next) == sym_comment) {
     TSPoint end = ts_node_end_point(node);
     TSPoint nstart = ts_node_start_point(next);
@@ -156,13 +277,12 @@ void print_statement(TSNode node, PrpfmtState *st) {
     }
   }
 
-  fprintf(st->outfile, "\n");
+  print_literal("\n", st);
 }
 
 void print_assignment_or_declaration_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
@@ -182,27 +302,26 @@ void print_assignment_or_declaration_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_control_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
 
-    if (field_name && strcmp(field_name, "argument") == 0) {
-      fprintf(st->outfile, " ");
+    if (field == field_argument) {
+      print_literal(" ", st);
       print__expression_with_comprehension(child, st);
       continue;
     }
 
     switch (symbol) {
       case anon_sym_continue:
-        fprintf(st->outfile, "continue");
+        print_literal("continue", st);
         break;
       case anon_sym_break:
-        fprintf(st->outfile, "break");
+        print_literal("break", st);
         break;
       case anon_sym_return:
-        fprintf(st->outfile, "return");
+        print_literal("return", st);
         break;
       case sym_when_unless_cond:
       case anon_sym_SEMI:
@@ -217,19 +336,18 @@ void print_control_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_declaration_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "decl") == 0) {
+    if (field) {
+      if (field == field_decl) {
         print_var_or_let_or_reg(child, st);
-        fprintf(st->outfile, " ");
+        print_literal(" ", st);
         continue;
       }
-      if (strcmp(field_name, "lvalue") == 0) {
+      if (field == field_lvalue) {
         if (symbol == sym_typed_identifier_list) {
           print_typed_identifier_list(child, st);
         } else {
@@ -241,10 +359,10 @@ void print_declaration_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_LPAREN:
-        fprintf(st->outfile, "(");
+        print_literal("(", st);
         break;
       case anon_sym_RPAREN:
-        fprintf(st->outfile, ")");
+        print_literal(")", st);
         break;
       case sym_when_unless_cond:
       case anon_sym_SEMI:
@@ -259,9 +377,8 @@ void print_declaration_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_enum_assignment_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == sym_enum_assignment) {
@@ -275,10 +392,8 @@ void print_enum_assignment_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_expression_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
@@ -301,24 +416,21 @@ void print_expression_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_for_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "attributes") == 0) {
+    if (field) {
+      if (field == field_attributes) {
         if (symbol == sym_attribute_list) {
-          fprintf(st->outfile, "::");
+          print_literal("::", st);
           print_attribute_list(child, st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_COLON_COLON) {
-              fprintf(st->outfile, "::");
+              print_literal("::", st);
             } else if (s2 == sym_attribute_list) {
               print_attribute_list(c2, st);
             }
@@ -326,27 +438,25 @@ void print_for_statement(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "init") == 0) {
+      if (field == field_init) {
         if (symbol == sym_stmt_list) {
           print_stmt_list(child, st);
-          fprintf(st->outfile, "; ");
+          print_literal("; ", st);
         } else if (symbol == anon_sym_SEMI) {
-          fprintf(st->outfile, "; ");
+          print_literal("; ", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == sym_stmt_list) {
               print_stmt_list(c2, st);
             } else if (s2 == anon_sym_SEMI) {
-              fprintf(st->outfile, "; ");
+              print_literal("; ", st);
             }
           }
         }
         continue;
       }
-      if (strcmp(field_name, "index") == 0) {
+      if (field == field_index) {
         if (symbol == sym_typed_identifier_list) {
           print_typed_identifier_list(child, st);
         } else {
@@ -354,12 +464,12 @@ void print_for_statement(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "data") == 0) {
+      if (field == field_data) {
         print_expression_list(child, st);
         continue;
       }
-      if (strcmp(field_name, "code") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_code) {
+        print_literal(" ", st);
         print_scope_statement(child, st);
         continue;
       }
@@ -367,16 +477,16 @@ void print_for_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_for:
-        fprintf(st->outfile, "for ");
+        print_literal("for ", st);
         break;
       case anon_sym_LPAREN:
-        fprintf(st->outfile, "(");
+        print_literal("(", st);
         break;
       case anon_sym_RPAREN:
-        fprintf(st->outfile, ")");
+        print_literal(")", st);
         break;
       case anon_sym_in:
-        fprintf(st->outfile, " in ");
+        print_literal(" in ", st);
         break;
       case sym_typed_identifier:
         print_typed_identifier(child, st);
@@ -392,19 +502,18 @@ void print_for_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_function_call_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
 
-    if (field_name) {
-      if (strcmp(field_name, "function") == 0) {
+    if (field) {
+      if (field == field_function) {
         print_complex_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "argument") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_argument) {
+        print_literal(" ", st);
         print_expression_list(child, st);
         continue;
       }
@@ -421,18 +530,17 @@ void print_function_call_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_impl_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "trait_name") == 0 || strcmp(field_name, "type_name") == 0) {
+    if (field) {
+      if (field == field_trait_name || field == field_type_name) {
         print_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "implementation") == 0) {
+      if (field == field_implementation) {
         print_tuple(child, st);
         continue;
       }
@@ -440,10 +548,10 @@ void print_impl_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_impl:
-        fprintf(st->outfile, "impl ");
+        print_literal("impl ", st);
         break;
       case anon_sym_for:
-        fprintf(st->outfile, " for ");
+        print_literal(" for ", st);
         break;
       case sym_when_unless_cond:
       case anon_sym_SEMI:
@@ -458,14 +566,13 @@ void print_impl_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_import_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "module") == 0) {
+    if (field) {
+      if (field == field_module) {
         if (symbol == sym_module_path) {
           print_module_path(child, st);
         } else {
@@ -473,7 +580,7 @@ void print_import_statement(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "alias") == 0) {
+      if (field == field_alias) {
         print_identifier(child, st);
         continue;
       }
@@ -481,10 +588,10 @@ void print_import_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_import:
-        fprintf(st->outfile, "import ");
+        print_literal("import ", st);
         break;
       case anon_sym_as:
-        fprintf(st->outfile, " as ");
+        print_literal(" as ", st);
         break;
       case sym_when_unless_cond:
       case anon_sym_SEMI:
@@ -499,35 +606,14 @@ void print_import_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_lambda(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  bool has_name = false;
-  for (uint32_t i = 0; i < child_count; i++) {
-    const char *fn = ts_node_field_name_for_child(node, i);
-    if (fn && strcmp(fn, "name") == 0) {
-      has_name = true;
-      break;
-    }
-    TSNode child = ts_node_child(node, i);
-    if (ts_node_grammar_symbol(child) == sym_function_definition_decl) {
-      uint32_t cc2 = ts_node_child_count(child);
-      for (uint32_t j = 0; j < cc2; j++) {
-        const char *fn2 = ts_node_field_name_for_child(child, j);
-        if (fn2 && strcmp(fn2, "name") == 0) {
-          has_name = true;
-          break;
-        }
-      }
-    }
-    if (has_name) break;
-  }
+  bool has_name = !ts_node_is_null(ts_node_child_by_field_id(node, field_name));
 
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "func_type") == 0) {
+    if (field) {
+      if (field == field_func_type) {
         switch (symbol) {
           case sym_comb_tok:
             print_comb_tok(child, st);
@@ -540,16 +626,16 @@ void print_lambda(TSNode node, PrpfmtState *st) {
             break;
         }
         if (has_name) {
-          fprintf(st->outfile, " ");
+          print_literal(" ", st);
         }
         continue;
       }
-      if (strcmp(field_name, "name") == 0) {
+      if (field == field_name) {
         print_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "code") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_code) {
+        print_literal(" ", st);
         print_scope_statement(child, st);
         continue;
       }
@@ -562,24 +648,21 @@ void print_lambda(TSNode node, PrpfmtState *st) {
 }
 
 void print_loop_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "attributes") == 0) {
+    if (field) {
+      if (field == field_attributes) {
         if (symbol == sym_attribute_list) {
-          fprintf(st->outfile, "::");
+          print_literal("::", st);
           print_attribute_list(child, st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_COLON_COLON) {
-              fprintf(st->outfile, "::");
+              print_literal("::", st);
             } else if (s2 == sym_attribute_list) {
               print_attribute_list(c2, st);
             }
@@ -587,12 +670,12 @@ void print_loop_statement(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "init") == 0) {
+      if (field == field_init) {
         print_stmt_list(child, st);
         continue;
       }
-      if (strcmp(field_name, "code") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_code) {
+        print_literal(" ", st);
         print_scope_statement(child, st);
         continue;
       }
@@ -600,7 +683,7 @@ void print_loop_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_loop:
-        fprintf(st->outfile, "loop ");
+        print_literal("loop ", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -610,14 +693,13 @@ void print_loop_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_scope_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_LBRACE:
-        fprintf(st->outfile, "{\n");
+        print_literal("{\n", st);
         st->indent_level++;
         break;
       case sym_statement:
@@ -626,7 +708,7 @@ void print_scope_statement(TSNode node, PrpfmtState *st) {
       case anon_sym_RBRACE:
         st->indent_level--;
         print_indent(st);
-        fprintf(st->outfile, "}");
+        print_literal("}", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -636,34 +718,31 @@ void print_scope_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_test_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "args") == 0) {
-        fprintf(st->outfile, " ");
+    if (field) {
+      if (field == field_args) {
+        print_literal(" ", st);
         print_expression_list(child, st);
         continue;
       }
-      if (strcmp(field_name, "condition") == 0) {
+      if (field == field_condition) {
         // Handle flattened optseq('where', $.expression_list)
-        uint32_t cc2 = ts_node_child_count(child);
-        for (uint32_t j = 0; j < cc2; j++) {
-          TSNode c2 = ts_node_child(child, j);
+        for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
           TSSymbol s2 = ts_node_grammar_symbol(c2);
           if (s2 == anon_sym_where) {
-            fprintf(st->outfile, " where ");
+            print_literal(" where ", st);
           } else if (s2 == sym_expression_list) {
             print_expression_list(c2, st);
           }
         }
         continue;
       }
-      if (strcmp(field_name, "code") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_code) {
+        print_literal(" ", st);
         print_scope_statement(child, st);
         continue;
       }
@@ -671,7 +750,7 @@ void print_test_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_test:
-        fprintf(st->outfile, "test");
+        print_literal("test", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -681,31 +760,28 @@ void print_test_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_type_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "name") == 0) {
+    if (field) {
+      if (field == field_name) {
         print_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "generic") == 0) {
+      if (field == field_generic) {
         if (symbol == sym_typed_identifier_list) {
-          fprintf(st->outfile, "<");
+          print_literal("<", st);
           print_typed_identifier_list(child, st);
-          fprintf(st->outfile, ">");
+          print_literal(">", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_LT) {
-              fprintf(st->outfile, "<");
+              print_literal("<", st);
             } else if (s2 == anon_sym_GT) {
-              fprintf(st->outfile, ">");
+              print_literal(">", st);
             } else if (s2 == sym_typed_identifier_list) {
               print_typed_identifier_list(c2, st);
             }
@@ -713,12 +789,12 @@ void print_type_statement(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "definition") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_definition) {
+        print_literal(" ", st);
         print_tuple(child, st);
         continue;
       }
-      if (strcmp(field_name, "alias") == 0) {
+      if (field == field_alias) {
         print__type(child, st);
         continue;
       }
@@ -726,10 +802,10 @@ void print_type_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_type:
-        fprintf(st->outfile, "type ");
+        print_literal("type ", st);
         break;
       case anon_sym_EQ:
-        fprintf(st->outfile, " = ");
+        print_literal(" = ", st);
         break;
       case sym_when_unless_cond:
       case anon_sym_SEMI:
@@ -744,24 +820,21 @@ void print_type_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_while_statement(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "attributes") == 0) {
+    if (field) {
+      if (field == field_attributes) {
         if (symbol == sym_attribute_list) {
-          fprintf(st->outfile, "::");
+          print_literal("::", st);
           print_attribute_list(child, st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_COLON_COLON) {
-              fprintf(st->outfile, "::");
+              print_literal("::", st);
             } else if (s2 == sym_attribute_list) {
               print_attribute_list(c2, st);
             }
@@ -769,33 +842,31 @@ void print_while_statement(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "init") == 0) {
+      if (field == field_init) {
         if (symbol == sym_stmt_list) {
           print_stmt_list(child, st);
-          fprintf(st->outfile, "; ");
+          print_literal("; ", st);
         } else if (symbol == anon_sym_SEMI) {
-          fprintf(st->outfile, "; ");
+          print_literal("; ", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == sym_stmt_list) {
               print_stmt_list(c2, st);
             } else if (s2 == anon_sym_SEMI) {
-              fprintf(st->outfile, "; ");
+              print_literal("; ", st);
             }
           }
         }
         continue;
       }
-      if (strcmp(field_name, "condition") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_condition) {
+        print_literal(" ", st);
         print__expression(child, st);
         continue;
       }
-      if (strcmp(field_name, "code") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_code) {
+        print_literal(" ", st);
         print_scope_statement(child, st);
         continue;
       }
@@ -803,7 +874,7 @@ void print_while_statement(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_while:
-        fprintf(st->outfile, "while ");
+        print_literal("while ", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -813,19 +884,18 @@ void print_while_statement(TSNode node, PrpfmtState *st) {
 }
 
 void print_assignment(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
 
-    if (field_name) {
-      if (strcmp(field_name, "decl") == 0) {
+    if (field) {
+      if (field == field_decl) {
         print_var_or_let_or_reg(child, st);
-        fprintf(st->outfile, " ");
+        print_literal(" ", st);
         continue;
       }
-      if (strcmp(field_name, "lvalue") == 0) {
+      if (field == field_lvalue) {
         if (symbol == sym_lvalue_list) {
           print_lvalue_list(child, st);
         } else if (symbol == sym_typed_identifier) {
@@ -835,21 +905,21 @@ void print_assignment(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "type") == 0) {
+      if (field == field_type) {
         print_type_cast(child, st);
         continue;
       }
-      if (strcmp(field_name, "operator") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_operator) {
+        print_literal(" ", st);
         print_assignment_operator(child, st);
-        fprintf(st->outfile, " ");
+        print_literal(" ", st);
         continue;
       }
-      if (strcmp(field_name, "delay") == 0) {
+      if (field == field_delay) {
         print_assignment_delay(child, st);
         continue;
       }
-      if (strcmp(field_name, "rvalue") == 0) {
+      if (field == field_rvalue) {
         if (symbol == sym_enum_definition) {
           print_enum_definition(child, st);
         } else if (symbol == sym_ref_identifier) {
@@ -863,30 +933,29 @@ void print_assignment(TSNode node, PrpfmtState *st) {
 
     // Handle literals/structural tokens
     switch (symbol) {
-      case anon_sym_LPAREN: fprintf(st->outfile, "("); break;
-      case anon_sym_RPAREN: fprintf(st->outfile, ")"); break;
+      case anon_sym_LPAREN: print_literal("(", st); break;
+      case anon_sym_RPAREN: print_literal(")", st); break;
       case sym_comment: print_comment(child, st); break;
     }
   }
 }
 
 void print_enum_assignment(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "name") == 0) {
+    if (field) {
+      if (field == field_name) {
         print_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "values") == 0) {
+      if (field == field_values) {
         print_tuple(child, st);
         continue;
       }
-      if (strcmp(field_name, "body") == 0) {
+      if (field == field_body) {
         print_arg_list(child, st);
         continue;
       }
@@ -894,13 +963,13 @@ void print_enum_assignment(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_enum:
-        fprintf(st->outfile, "enum ");
+        print_literal("enum ", st);
         break;
       case anon_sym_variant:
-        fprintf(st->outfile, "variant ");
+        print_literal("variant ", st);
         break;
       case anon_sym_EQ:
-        fprintf(st->outfile, " = ");
+        print_literal(" = ", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -910,32 +979,26 @@ void print_enum_assignment(TSNode node, PrpfmtState *st) {
 }
 
 void print_arg_item(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "mod") == 0) {
-        char *text = get_node_text(child, st->source_code);
-        if (text) {
-          fprintf(st->outfile, "%s ", text);
-          free(text);
-        }
+    if (field) {
+      if (field == field_mod) {
+        print_node_text(child, st);
+        print_literal(" ", st);
         continue;
       }
-      if (strcmp(field_name, "definition") == 0) {
+      if (field == field_definition) {
         if (symbol == anon_sym_EQ) {
-          fprintf(st->outfile, " = ");
+          print_literal(" = ", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          if (cc2 > 0) {
-            for (uint32_t j = 0; j < cc2; j++) {
-              TSNode c2 = ts_node_child(child, j);
+          if (ts_node_child_count(child) > 0) {
+            for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
               TSSymbol s2 = ts_node_grammar_symbol(c2);
               if (s2 == anon_sym_EQ) {
-                fprintf(st->outfile, " = ");
+                print_literal(" = ", st);
               } else {
                 print__expression_with_comprehension(c2, st);
               }
@@ -960,14 +1023,13 @@ void print_arg_item(TSNode node, PrpfmtState *st) {
 }
 
 void print_arg_item_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_COMMA:
-        fprintf(st->outfile, ", ");
+        print_literal(", ", st);
         break;
       case sym_arg_item:
         print_arg_item(child, st);
@@ -980,17 +1042,16 @@ void print_arg_item_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_arg_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_LPAREN:
-        fprintf(st->outfile, "(");
+        print_literal("(", st);
         break;
       case anon_sym_RPAREN:
-        fprintf(st->outfile, ")");
+        print_literal(")", st);
         break;
       case sym_arg_item_list:
         print_arg_item_list(child, st);
@@ -1003,18 +1064,17 @@ void print_arg_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_array_type(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "length") == 0) {
+    if (field) {
+      if (field == field_length) {
         print_tuple_sq(child, st);
         continue;
       }
-      if (strcmp(field_name, "base") == 0) {
+      if (field == field_base) {
         switch (symbol) {
           case sym_primitive_type:
             print_primitive_type(child, st);
@@ -1040,9 +1100,8 @@ void print_array_type(TSNode node, PrpfmtState *st) {
 }
 
 void print_assignment_delay(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
@@ -1050,13 +1109,13 @@ void print_assignment_delay(TSNode node, PrpfmtState *st) {
         print_delay_tok(child, st);
         break;
       case anon_sym_AT:
-        fprintf(st->outfile, "@");
+        print_literal("@", st);
         break;
       case anon_sym_LBRACK:
-        fprintf(st->outfile, "[");
+        print_literal("[", st);
         break;
       case anon_sym_RBRACK:
-        fprintf(st->outfile, "]");
+        print_literal("]", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -1069,26 +1128,17 @@ void print_assignment_delay(TSNode node, PrpfmtState *st) {
 }
 
 void print_assignment_operator(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_attribute_item(TSNode node, PrpfmtState *st) {
   uint32_t child_count = ts_node_child_count(node);
   if (child_count == 0) {
-    char *text = get_node_text(node, st->source_code);
-    if (text) {
-      fprintf(st->outfile, "%s", text);
-      free(text);
-    }
+    print_node_text(node, st);
     return;
   }
 
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == sym_assignment) {
@@ -1102,14 +1152,13 @@ void print_attribute_item(TSNode node, PrpfmtState *st) {
 }
 
 void print_attribute_item_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_COMMA:
-        fprintf(st->outfile, ", ");
+        print_literal(", ", st);
         break;
       case sym_attribute_item:
         print_attribute_item(child, st);
@@ -1122,17 +1171,16 @@ void print_attribute_item_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_attribute_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_LBRACK:
-        fprintf(st->outfile, "[");
+        print_literal("[", st);
         break;
       case anon_sym_RBRACK:
-        fprintf(st->outfile, "]");
+        print_literal("]", st);
         break;
       case sym_attribute_item_list:
         print_attribute_item_list(child, st);
@@ -1145,86 +1193,134 @@ void print_attribute_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_attributes(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == anon_sym_COLON) {
-      fprintf(st->outfile, ":");
+      print_literal(":", st);
     } else if (symbol == sym_attribute_list) {
       print_attribute_list(child, st);
     }
   }
 }
 
-void print_binary_expression(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+// Operator chains (a + b + c ..., - - x, x??) nest one tree level per
+// operator, as deep as generated code makes them. They are printed by one
+// loop over the shared cursor: an operand that is itself a chain is entered
+// in place, with its symbol pushed on an explicit stack, instead of going
+// through print__expression. Work per node is constant and the C stack does
+// not grow with the chain.
+static bool is_operator_chain(TSSymbol symbol) {
+  return symbol == sym_binary_expression || symbol == sym_unary_expression || symbol == sym_optional_expression;
+}
 
-    if (field_name) {
-      if (strcmp(field_name, "left") == 0 || strcmp(field_name, "right") == 0) {
-        print__expression(child, st);
-        continue;
-      }
-      if (strcmp(field_name, "operator") == 0) {
-        fprintf(st->outfile, " ");
-        char *text = get_node_text(child, st->source_code);
-        if (text) {
-          fprintf(st->outfile, "%s", text);
-          free(text);
-        }
-        fprintf(st->outfile, " ");
-        continue;
+static void print_chain_operator(TSSymbol parent, TSNode child, PrpfmtState *st) {
+  if (parent == sym_binary_expression) {
+    print_literal(" ", st);
+    print_node_text(child, st);
+    print_literal(" ", st);
+  } else if (parent == sym_unary_expression) {
+    print_node_text(child, st);
+    if (node_text_equals(child, "not", st)) {
+      print_literal(" ", st);
+    }
+  } else {
+    print_literal("?", st);
+  }
+}
+
+// Make room for one more symbol on a chain stack that starts out in the
+// caller's inline buffer
+static bool chain_reserve(TSSymbol **stack, uint32_t *capacity, const TSSymbol *inline_stack, uint32_t depth) {
+  if (depth < *capacity) {
+    return true;
+  }
+  TSSymbol *grown = *stack == inline_stack ? malloc(2 * *capacity * sizeof(TSSymbol))
+                                           : realloc(*stack, 2 * *capacity * sizeof(TSSymbol));
+  if (!grown) {
+    return false;
+  }
+  if (*stack == inline_stack) {
+    memcpy(grown, inline_stack, depth * sizeof(TSSymbol));
+  }
+  *stack = grown;
+  *capacity *= 2;
+  return true;
+}
+
+static void print_operator_chain(TSNode node, PrpfmtState *st) {
+  TSSymbol inline_stack[64];
+  TSSymbol *stack = inline_stack;
+  uint32_t capacity = sizeof(inline_stack) / sizeof(inline_stack[0]);
+  uint32_t depth = 0;
+
+  stack[depth++] = ts_node_grammar_symbol(node);
+  TSNode child = cursor_first_child(st);
+  while (depth > 0) {
+    // cursor_next_sibling has moved back up to the chain node
+    if (ts_node_is_null(child)) {
+      if (--depth > 0) {
+        child = cursor_next_sibling(st);
       }
+      continue;
     }
-    
-    if (ts_node_child_count(child) == 0) {
-      char *text = get_node_text(child, st->source_code);
-      if (text) {
-        fprintf(st->outfile, "%s", text);
-        free(text);
+
+    TSSymbol parent = stack[depth - 1];
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
+    if (field == field_operator) {
+      print_chain_operator(parent, child, st);
+    } else if (field == field_left || field == field_right || field == field_argument) {
+      TSSymbol symbol = ts_node_grammar_symbol(child);
+      if (is_operator_chain(symbol) && chain_reserve(&stack, &capacity, inline_stack, depth)) {
+        stack[depth++] = symbol;
+        child = cursor_first_child(st);
+        continue;
       }
+      print__expression(child, st);
+    } else if (parent == sym_binary_expression && ts_node_child_count(child) == 0) {
+      print_node_text(child, st);
     }
+    child = cursor_next_sibling(st);
   }
+
+  if (stack != inline_stack) {
+    free(stack);
+  }
+}
+
+void print_binary_expression(TSNode node, PrpfmtState *st) {
+  print_operator_chain(node, st);
 }
 
 void print_bit_select(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
 
-    if (field_name && strcmp(field_name, "type") == 0) {
+    if (field == field_type) {
       print_bit_select_type(child, st);
       continue;
     }
-    if (field_name && strcmp(field_name, "select") == 0) {
+    if (field == field_select) {
       print_select(child, st);
       continue;
     }
 
     if (symbol == anon_sym_POUND) {
-      fprintf(st->outfile, "#");
+      print_literal("#", st);
     }
   }
 }
 
 void print_bit_select_type(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_bit_selection(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == sym_bit_select) {
@@ -1236,29 +1332,22 @@ void print_bit_selection(TSNode node, PrpfmtState *st) {
 }
 
 void print_boolean_type(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_bounded_integer_type(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name && strcmp(field_name, "constrained") == 0) {
-      uint32_t cc2 = ts_node_child_count(child);
-      for (uint32_t j = 0; j < cc2; j++) {
-        TSNode c2 = ts_node_child(child, j);
+    if (field == field_constrained) {
+      for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
         TSSymbol s2 = ts_node_grammar_symbol(c2);
         if (s2 == anon_sym_LPAREN) {
-          fprintf(st->outfile, "(");
+          print_literal("(", st);
         } else if (s2 == anon_sym_RPAREN) {
-          fprintf(st->outfile, ")");
+          print_literal(")", st);
         } else if (s2 == sym_select_options) {
           print_select_options(c2, st);
         }
@@ -1273,21 +1362,17 @@ void print_bounded_integer_type(TSNode node, PrpfmtState *st) {
 }
 
 void print_cassert_statement(TSNode node, PrpfmtState *st) {
-    fprintf(st->outfile, "cassert_statement\n");
+  (void)node;
+    print_literal("cassert_statement\n", st);
 }
 
 void print_comb_tok(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_complex_identifier(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
@@ -1309,11 +1394,7 @@ void print_complex_identifier(TSNode node, PrpfmtState *st) {
       default:
         // If child is a token, print it
         if (ts_node_child_count(child) == 0) {
-          char *text = get_node_text(child, st->source_code);
-          if (text) {
-            fprintf(st->outfile, "%s", text);
-            free(text);
-          }
+          print_node_text(child, st);
         }
         break;
     }
@@ -1321,14 +1402,13 @@ void print_complex_identifier(TSNode node, PrpfmtState *st) {
 }
 
 void print_complex_identifier_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_COMMA:
-        fprintf(st->outfile, ", ");
+        print_literal(", ", st);
         break;
       case sym_complex_identifier:
         print_complex_identifier(child, st);
@@ -1341,37 +1421,24 @@ void print_complex_identifier_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_complex_string_literal(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_constant(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_delay_tok(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_dot_expression(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == anon_sym_DOT) {
-      fprintf(st->outfile, ".");
+      print_literal(".", st);
     } else if (symbol == sym_identifier) {
       print_identifier(child, st);
     } else if (symbol == sym_constant) {
@@ -1383,13 +1450,12 @@ void print_dot_expression(TSNode node, PrpfmtState *st) {
 }
 
 void print_dot_expression_type(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == anon_sym_DOT) {
-      fprintf(st->outfile, ".");
+      print_literal(".", st);
     } else if (symbol == sym_identifier) {
       print_identifier(child, st);
     } else if (symbol == sym_expression_type) {
@@ -1401,23 +1467,22 @@ void print_dot_expression_type(TSNode node, PrpfmtState *st) {
 }
 
 void print_enum_definition(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name && strcmp(field_name, "input") == 0) {
+    if (field == field_input) {
       print_arg_list(child, st);
       continue;
     }
 
     switch (symbol) {
       case anon_sym_enum:
-        fprintf(st->outfile, "enum ");
+        print_literal("enum ", st);
         break;
       case anon_sym_variant:
-        fprintf(st->outfile, "variant ");
+        print_literal("variant ", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -1427,13 +1492,12 @@ void print_enum_definition(TSNode node, PrpfmtState *st) {
 }
 
 void print_expression_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
     
     if (symbol == anon_sym_COMMA) {
-      fprintf(st->outfile, ", ");
+      print_literal(", ", st);
     } else if (symbol == sym_comment) {
       print_comment(child, st);
     } else {
@@ -1461,18 +1525,12 @@ void print_expression_type(TSNode node, PrpfmtState *st) {
     default:
       // Handle the case where expression_type is a named node with children
       {
-        uint32_t cc = ts_node_child_count(node);
-        if (cc > 0) {
-          for (uint32_t i = 0; i < cc; i++) {
-            TSNode child = ts_node_child(node, i);
+        if (ts_node_child_count(node) > 0) {
+          for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
             print_expression_type(child, st);
           }
         } else {
-          char *text = get_node_text(node, st->source_code);
-          if (text) {
-            fprintf(st->outfile, "%s", text);
-            free(text);
-          }
+          print_node_text(node, st);
         }
       }
       break;
@@ -1480,22 +1538,17 @@ void print_expression_type(TSNode node, PrpfmtState *st) {
 }
 
 void print_flow_tok(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_for_comprehension(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "index") == 0) {
+    if (field) {
+      if (field == field_index) {
         if (symbol == sym_typed_identifier_list) {
           print_typed_identifier_list(child, st);
         } else {
@@ -1503,11 +1556,11 @@ void print_for_comprehension(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "data") == 0) {
+      if (field == field_data) {
         print_expression_list(child, st);
         continue;
       }
-      if (strcmp(field_name, "condition") == 0) {
+      if (field == field_condition) {
         print_stmt_list(child, st);
         continue;
       }
@@ -1515,19 +1568,19 @@ void print_for_comprehension(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_for:
-        fprintf(st->outfile, "for ");
+        print_literal("for ", st);
         break;
       case anon_sym_LPAREN:
-        fprintf(st->outfile, "(");
+        print_literal("(", st);
         break;
       case anon_sym_RPAREN:
-        fprintf(st->outfile, ")");
+        print_literal(")", st);
         break;
       case anon_sym_in:
-        fprintf(st->outfile, " in ");
+        print_literal(" in ", st);
         break;
       case anon_sym_if:
-        fprintf(st->outfile, " if ");
+        print_literal(" if ", st);
         break;
       case sym_typed_identifier:
         print_typed_identifier(child, st);
@@ -1540,17 +1593,12 @@ void print_for_comprehension(TSNode node, PrpfmtState *st) {
 }
 
 void print_func_def_verification(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    TSSymbol symbol = ts_node_grammar_symbol(child);
-
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     if (ts_node_child_count(child) == 0) {
-      char *text = get_node_text(child, st->source_code);
-      if (text) {
-        fprintf(st->outfile, " %s ", text);
-        free(text);
-      }
+      print_literal(" ", st);
+      print_node_text(child, st);
+      print_literal(" ", st);
     } else {
       print__expression(child, st);
     }
@@ -1558,18 +1606,17 @@ void print_func_def_verification(TSNode node, PrpfmtState *st) {
 }
 
 void print_function_call_expression(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "function") == 0) {
+    if (field) {
+      if (field == field_function) {
         print_complex_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "argument") == 0) {
+      if (field == field_argument) {
         print_tuple(child, st);
         continue;
       }
@@ -1582,18 +1629,17 @@ void print_function_call_expression(TSNode node, PrpfmtState *st) {
 }
 
 void print_function_call_type(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "function") == 0) {
+    if (field) {
+      if (field == field_function) {
         print_complex_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "argument") == 0) {
+      if (field == field_argument) {
         print_tuple(child, st);
         continue;
       }
@@ -1606,25 +1652,24 @@ void print_function_call_type(TSNode node, PrpfmtState *st) {
 }
 
 void print_function_definition(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "lvalue") == 0) {
+    if (field) {
+      if (field == field_lvalue) {
         print_complex_identifier(child, st);
         continue;
-      } else if (strcmp(field_name, "condition") == 0) {
-        fprintf(st->outfile, " where ");
+      } else if (field == field_condition) {
+        print_literal(" where ", st);
         print_expression_list(child, st);
         continue;
-      } else if (strcmp(field_name, "verification") == 0) {
+      } else if (field == field_verification) {
         print_func_def_verification(child, st);
         continue;
-      } else if (strcmp(field_name, "code") == 0) {
-        fprintf(st->outfile, " ");
+      } else if (field == field_code) {
+        print_literal(" ", st);
         print_scope_statement(child, st);
         continue;
       }
@@ -1637,31 +1682,28 @@ void print_function_definition(TSNode node, PrpfmtState *st) {
 }
 
 void print_function_definition_decl(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "generic") == 0) {
+    if (field) {
+      if (field == field_generic) {
         if (symbol == sym_typed_identifier_list) {
-          fprintf(st->outfile, "<");
+          print_literal("<", st);
           print_typed_identifier_list(child, st);
-          fprintf(st->outfile, ">");
+          print_literal(">", st);
         } else if (symbol == sym_arg_item_list) {
-          fprintf(st->outfile, "<");
+          print_literal("<", st);
           print_arg_item_list(child, st);
-          fprintf(st->outfile, ">");
+          print_literal(">", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_LT) {
-              fprintf(st->outfile, "<");
+              print_literal("<", st);
             } else if (s2 == anon_sym_GT) {
-              fprintf(st->outfile, ">");
+              print_literal(">", st);
             } else if (s2 == sym_typed_identifier_list) {
               print_typed_identifier_list(c2, st);
             } else if (s2 == sym_arg_item_list) {
@@ -1670,24 +1712,22 @@ void print_function_definition_decl(TSNode node, PrpfmtState *st) {
           }
         }
         continue;
-      } else if (strcmp(field_name, "capture") == 0) {
+      } else if (field == field_capture) {
         if (symbol == sym_typed_identifier_list) {
-          fprintf(st->outfile, "[");
+          print_literal("[", st);
           print_typed_identifier_list(child, st);
-          fprintf(st->outfile, "]");
+          print_literal("]", st);
         } else if (symbol == sym_arg_item_list) {
-          fprintf(st->outfile, "[");
+          print_literal("[", st);
           print_arg_item_list(child, st);
-          fprintf(st->outfile, "]");
+          print_literal("]", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_LBRACK) {
-              fprintf(st->outfile, "[");
+              print_literal("[", st);
             } else if (s2 == anon_sym_RBRACK) {
-              fprintf(st->outfile, "]");
+              print_literal("]", st);
             } else if (s2 == sym_typed_identifier_list) {
               print_typed_identifier_list(c2, st);
             } else if (s2 == sym_arg_item_list) {
@@ -1696,39 +1736,35 @@ void print_function_definition_decl(TSNode node, PrpfmtState *st) {
           }
         }
         continue;
-      } else if (strcmp(field_name, "pipe_config") == 0) {
+      } else if (field == field_pipe_config) {
         if (symbol == sym_attribute_list) {
-          fprintf(st->outfile, "::");
+          print_literal("::", st);
           print_attribute_list(child, st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_COLON_COLON) {
-              fprintf(st->outfile, "::");
+              print_literal("::", st);
             } else if (s2 == sym_attribute_list) {
               print_attribute_list(c2, st);
             }
           }
         }
         continue;
-      } else if (strcmp(field_name, "input") == 0) {
+      } else if (field == field_input) {
         if (symbol == sym_arg_list) {
           print_arg_list(child, st);
         } else if (symbol == sym_arg_item_list) {
-          fprintf(st->outfile, "(");
+          print_literal("(", st);
           print_arg_item_list(child, st);
-          fprintf(st->outfile, ")");
+          print_literal(")", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == anon_sym_LPAREN) {
-              fprintf(st->outfile, "(");
+              print_literal("(", st);
             } else if (s2 == anon_sym_RPAREN) {
-              fprintf(st->outfile, ")");
+              print_literal(")", st);
             } else if (s2 == sym_arg_list) {
               print_arg_list(c2, st);
             } else if (s2 == sym_arg_item_list) {
@@ -1737,18 +1773,14 @@ void print_function_definition_decl(TSNode node, PrpfmtState *st) {
           }
         }
         continue;
-      } else if (strcmp(field_name, "output") == 0) {
+      } else if (field == field_output) {
         if (symbol == sym_arg_list) {
           print_arg_list(child, st);
         } else if (symbol == sym_type_or_identifier) {
           print_type_or_identifier(child, st);
         } else {
           // Handle cases like bool
-          char *text = get_node_text(child, st->source_code);
-          if (text) {
-            fprintf(st->outfile, "%s", text);
-            free(text);
-          }
+          print_node_text(child, st);
         }
         continue;
       }
@@ -1756,19 +1788,19 @@ void print_function_definition_decl(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_LT:
-        fprintf(st->outfile, "<");
+        print_literal("<", st);
         break;
       case anon_sym_GT:
-        fprintf(st->outfile, ">");
+        print_literal(">", st);
         break;
       case anon_sym_LBRACK:
-        fprintf(st->outfile, "[");
+        print_literal("[", st);
         break;
       case anon_sym_RBRACK:
-        fprintf(st->outfile, "]");
+        print_literal("]", st);
         break;
       case anon_sym_DASH_GT:
-        fprintf(st->outfile, " -> ");
+        print_literal(" -> ", st);
         break;
       case sym_typed_identifier_list:
         print_typed_identifier_list(child, st);
@@ -1784,49 +1816,44 @@ void print_function_definition_decl(TSNode node, PrpfmtState *st) {
 }
 
 void print_identifier(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_if_expression(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
 
-    if (field_name && strcmp(field_name, "condition") == 0) {
-      fprintf(st->outfile, " ");
+    if (field == field_condition) {
+      print_literal(" ", st);
       print__expression(child, st);
       continue;
     }
 
     switch (symbol) {
       case anon_sym_unique:
-        fprintf(st->outfile, "unique ");
+        print_literal("unique ", st);
         break;
       case anon_sym_if:
-        fprintf(st->outfile, "if");
+        print_literal("if", st);
         break;
       case sym_stmt_list:
-        fprintf(st->outfile, " ");
+        print_literal(" ", st);
         print_stmt_list(child, st);
         break;
       case anon_sym_SEMI:
-        fprintf(st->outfile, " ;");
+        print_literal(" ;", st);
         break;
       case sym_scope_statement:
-        fprintf(st->outfile, " ");
+        print_literal(" ", st);
         print_scope_statement(child, st);
         break;
       case anon_sym_elif:
-        fprintf(st->outfile, " elif");
+        print_literal(" elif", st);
         break;
       case anon_sym_else:
-        fprintf(st->outfile, " else");
+        print_literal(" else", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -1838,25 +1865,20 @@ void print_if_expression(TSNode node, PrpfmtState *st) {
 void print_lvalue_item(TSNode node, PrpfmtState *st) {
   uint32_t child_count = ts_node_child_count(node);
   if (child_count == 0) {
-    char *text = get_node_text(node, st->source_code);
-    if (text) {
-      fprintf(st->outfile, "%s", text);
-      free(text);
-    }
+    print_node_text(node, st);
     return;
   }
 
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "identifier") == 0) {
+    if (field) {
+      if (field == field_identifier) {
         print_complex_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "type") == 0) {
+      if (field == field_type) {
         print_type_cast(child, st);
         continue;
       }
@@ -1874,14 +1896,13 @@ void print_lvalue_item(TSNode node, PrpfmtState *st) {
 }
 
 void print_lvalue_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_COMMA:
-        fprintf(st->outfile, ", ");
+        print_literal(", ", st);
         break;
       case sym_lvalue_item:
         print_lvalue_item(child, st);
@@ -1894,37 +1915,34 @@ void print_lvalue_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_match_expression(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "init") == 0) {
+    if (field) {
+      if (field == field_init) {
         if (symbol == sym_stmt_list) {
           print_stmt_list(child, st);
-          fprintf(st->outfile, "; ");
+          print_literal("; ", st);
         } else if (symbol == anon_sym_SEMI) {
-          fprintf(st->outfile, "; ");
+          print_literal("; ", st);
         } else {
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == sym_stmt_list) {
               print_stmt_list(c2, st);
             } else if (s2 == anon_sym_SEMI) {
-              fprintf(st->outfile, "; ");
+              print_literal("; ", st);
             }
           }
         }
         continue;
-      } else if (strcmp(field_name, "condition") == 0) {
-        fprintf(st->outfile, " ");
+      } else if (field == field_condition) {
+        print_literal(" ", st);
         print__expression(child, st);
         continue;
-      } else if (strcmp(field_name, "match_list") == 0) {
+      } else if (field == field_match_list) {
         print_match_list(child, st);
         continue;
       }
@@ -1932,16 +1950,16 @@ void print_match_expression(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_match:
-        fprintf(st->outfile, "match");
+        print_literal("match", st);
         break;
       case anon_sym_LBRACE:
-        fprintf(st->outfile, " {\n");
+        print_literal(" {\n", st);
         st->indent_level++;
         break;
       case anon_sym_RBRACE:
         st->indent_level--;
         print_indent(st);
-        fprintf(st->outfile, "}");
+        print_literal("}", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -1951,36 +1969,33 @@ void print_match_expression(TSNode node, PrpfmtState *st) {
 }
 
 void print_match_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
+  (void)node;
   bool arm_started = false;
 
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "condition") == 0) {
+    if (field) {
+      if (field == field_condition) {
         if (!arm_started) {
           print_indent(st);
           arm_started = true;
         }
         if (symbol == anon_sym_else) {
-          fprintf(st->outfile, "else");
+          print_literal("else", st);
         } else if (symbol == sym_match_operator) {
           print_match_operator(child, st);
-          fprintf(st->outfile, " ");
+          print_literal(" ", st);
         } else if (symbol == sym_expression_list) {
           print_expression_list(child, st);
         } else {
           // Fallback for nested seq
-          uint32_t cc2 = ts_node_child_count(child);
-          for (uint32_t j = 0; j < cc2; j++) {
-            TSNode c2 = ts_node_child(child, j);
+          for (TSNode c2 = cursor_first_child(st); !ts_node_is_null(c2); c2 = cursor_next_sibling(st)) {
             TSSymbol s2 = ts_node_grammar_symbol(c2);
             if (s2 == sym_match_operator) {
               print_match_operator(c2, st);
-              fprintf(st->outfile, " ");
+              print_literal(" ", st);
             } else if (s2 == sym_expression_list) {
               print_expression_list(c2, st);
             }
@@ -1988,10 +2003,10 @@ void print_match_list(TSNode node, PrpfmtState *st) {
         }
         continue;
       }
-      if (strcmp(field_name, "code") == 0) {
-        fprintf(st->outfile, " ");
+      if (field == field_code) {
+        print_literal(" ", st);
         print_scope_statement(child, st);
-        fprintf(st->outfile, "\n");
+        print_literal("\n", st);
         arm_started = false;
         continue;
       }
@@ -2004,25 +2019,19 @@ void print_match_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_match_operator(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_member_select(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     print_select(child, st);
   }
 }
 
 void print_member_selection(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == sym_member_select) {
@@ -2034,14 +2043,13 @@ void print_member_selection(TSNode node, PrpfmtState *st) {
 }
 
 void print_module_path(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_DOT:
-        fprintf(st->outfile, ".");
+        print_literal(".", st);
         break;
       case sym_identifier:
         print_identifier(child, st);
@@ -2054,45 +2062,21 @@ void print_module_path(TSNode node, PrpfmtState *st) {
 }
 
 void print_optional_expression(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
-
-    if (field_name) {
-      if (strcmp(field_name, "argument") == 0) {
-        print__expression(child, st);
-        continue;
-      }
-      if (strcmp(field_name, "operator") == 0) {
-        fprintf(st->outfile, "?");
-        continue;
-      }
-    }
-  }
+  print_operator_chain(node, st);
 }
 
 void print_pipe_tok(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_primitive_type(TSNode node, PrpfmtState *st) {
   uint32_t child_count = ts_node_child_count(node);
   if (child_count == 0) {
-    char *text = get_node_text(node, st->source_code);
-    if (text) {
-      fprintf(st->outfile, "%s", text);
-      free(text);
-    }
+    print_node_text(node, st);
     return;
   }
 
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
@@ -2119,11 +2103,7 @@ void print_primitive_type(TSNode node, PrpfmtState *st) {
         break;
       default:
         if (ts_node_child_count(child) == 0) {
-          char *text = get_node_text(child, st->source_code);
-          if (text) {
-            fprintf(st->outfile, "%s", text);
-            free(text);
-          }
+          print_node_text(child, st);
         }
         break;
     }
@@ -2131,20 +2111,19 @@ void print_primitive_type(TSNode node, PrpfmtState *st) {
 }
 
 void print_range_type(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_range:
-        fprintf(st->outfile, "range");
+        print_literal("range", st);
         break;
       case anon_sym_LPAREN:
-        fprintf(st->outfile, "(");
+        print_literal("(", st);
         break;
       case anon_sym_RPAREN:
-        fprintf(st->outfile, ")");
+        print_literal(")", st);
         break;
       case sym_select_options:
         print_select_options(child, st);
@@ -2157,14 +2136,13 @@ void print_range_type(TSNode node, PrpfmtState *st) {
 }
 
 void print_ref_identifier(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_ref:
-        fprintf(st->outfile, "ref ");
+        print_literal("ref ", st);
         break;
       case sym_complex_identifier:
         print_complex_identifier(child, st);
@@ -2177,25 +2155,23 @@ void print_ref_identifier(TSNode node, PrpfmtState *st) {
 }
 
 void print_select(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     if (symbol == sym_select_options) {
       print_select_options(child, st);
     } else if (symbol == anon_sym_LBRACK) {
-      fprintf(st->outfile, "[");
+      print_literal("[", st);
     } else if (symbol == anon_sym_RBRACK) {
-      fprintf(st->outfile, "]");
+      print_literal("]", st);
     }
   }
 }
 
 void print_select_options(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
@@ -2203,13 +2179,13 @@ void print_select_options(TSNode node, PrpfmtState *st) {
         print_expression_list(child, st);
         break;
       case anon_sym_DOT_DOT:
-        fprintf(st->outfile, "..");
+        print_literal("..", st);
         break;
       case anon_sym_DOT_DOT_EQ:
-        fprintf(st->outfile, "..=");
+        print_literal("..=", st);
         break;
       case anon_sym_DOT_DOT_LT:
-        fprintf(st->outfile, "..<");
+        print_literal("..<", st);
         break;
       default:
         print__expression(child, st);
@@ -2219,9 +2195,8 @@ void print_select_options(TSNode node, PrpfmtState *st) {
 }
 
 void print_selection(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
@@ -2236,22 +2211,17 @@ void print_selection(TSNode node, PrpfmtState *st) {
 }
 
 void print_sized_integer_type(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_stmt_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_SEMI:
-        fprintf(st->outfile, " ; ");
+        print_literal(" ; ", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -2264,26 +2234,21 @@ void print_stmt_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_string_type(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_timed_identifier(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "identifier") == 0) {
+    if (field) {
+      if (field == field_identifier) {
         print_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "timing") == 0) {
+      if (field == field_timing) {
         if (symbol == sym_constant) {
           print_constant(child, st);
         } else {
@@ -2295,13 +2260,13 @@ void print_timed_identifier(TSNode node, PrpfmtState *st) {
 
     switch (symbol) {
       case anon_sym_AT:
-        fprintf(st->outfile, "@");
+        print_literal("@", st);
         break;
       case anon_sym_LBRACK:
-        fprintf(st->outfile, "[");
+        print_literal("[", st);
         break;
       case anon_sym_RBRACK:
-        fprintf(st->outfile, "]");
+        print_literal("]", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -2311,17 +2276,16 @@ void print_timed_identifier(TSNode node, PrpfmtState *st) {
 }
 
 void print_tuple(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_LPAREN:
-        fprintf(st->outfile, "(");
+        print_literal("(", st);
         break;
       case anon_sym_RPAREN:
-        fprintf(st->outfile, ")");
+        print_literal(")", st);
         break;
       case sym_tuple_list:
         print_tuple_list(child, st);
@@ -2334,14 +2298,13 @@ void print_tuple(TSNode node, PrpfmtState *st) {
 }
 
 void print_tuple_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_COMMA:
-        fprintf(st->outfile, ",");
+        print_literal(",", st);
         break;
       case sym_comment:
         print_comment(child, st);
@@ -2354,17 +2317,16 @@ void print_tuple_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_tuple_sq(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_LBRACK:
-        fprintf(st->outfile, "[");
+        print_literal("[", st);
         break;
       case anon_sym_RBRACK:
-        fprintf(st->outfile, "]");
+        print_literal("]", st);
         break;
       case sym_tuple_list:
         print_tuple_list(child, st);
@@ -2377,25 +2339,24 @@ void print_tuple_sq(TSNode node, PrpfmtState *st) {
 }
 
 void print_type_cast(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "type") == 0) {
+    if (field) {
+      if (field == field_type) {
         print__type(child, st);
         continue;
       }
-      if (strcmp(field_name, "attribute") == 0) {
+      if (field == field_attribute) {
         print_attributes(child, st);
         continue;
       }
     }
 
     if (symbol == anon_sym_COLON) {
-      fprintf(st->outfile, ":");
+      print_literal(":", st);
     }
   }
 }
@@ -2415,18 +2376,12 @@ void print_type_or_identifier(TSNode node, PrpfmtState *st) {
       break;
     default:
       {
-        uint32_t cc = ts_node_child_count(node);
-        if (cc > 0) {
-          for (uint32_t i = 0; i < cc; i++) {
-            TSNode child = ts_node_child(node, i);
+        if (ts_node_child_count(node) > 0) {
+          for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
             print_type_or_identifier(child, st);
           }
         } else {
-          char *text = get_node_text(node, st->source_code);
-          if (text) {
-            fprintf(st->outfile, "%s", text);
-            free(text);
-          }
+          print_node_text(node, st);
         }
       }
       break;
@@ -2434,55 +2389,49 @@ void print_type_or_identifier(TSNode node, PrpfmtState *st) {
 }
 
 void print_type_specification(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "argument") == 0) {
+    if (field) {
+      if (field == field_argument) {
         print__restricted_expression(child, st);
         continue;
       }
-      if (strcmp(field_name, "type") == 0) {
+      if (field == field_type) {
         print__type(child, st);
         continue;
       }
-      if (strcmp(field_name, "attribute") == 0) {
+      if (field == field_attribute) {
         print_attributes(child, st);
         continue;
       }
     }
 
     if (symbol == anon_sym_COLON) {
-      fprintf(st->outfile, ":");
+      print_literal(":", st);
     }
   }
 }
 
 void print_type_type(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_typed_declaration(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "decl") == 0) {
+    if (field) {
+      if (field == field_decl) {
         print_var_or_let_or_reg(child, st);
-        fprintf(st->outfile, " ");
+        print_literal(" ", st);
         continue;
       }
-      if (strcmp(field_name, "lvalue") == 0) {
+      if (field == field_lvalue) {
         print_typed_identifier(child, st);
         continue;
       }
@@ -2495,22 +2444,21 @@ void print_typed_declaration(TSNode node, PrpfmtState *st) {
 }
 
 void print_typed_identifier(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
-    if (field_name) {
-      if (strcmp(field_name, "identifier") == 0) {
+    if (field) {
+      if (field == field_identifier) {
         print_identifier(child, st);
         continue;
       }
-      if (strcmp(field_name, "type") == 0) {
+      if (field == field_type) {
         print_type_cast(child, st);
         continue;
       }
-      if (strcmp(field_name, "timing") == 0) {
+      if (field == field_timing) {
         if (symbol == sym_constant) {
           print_constant(child, st);
         } else {
@@ -2523,22 +2471,21 @@ void print_typed_identifier(TSNode node, PrpfmtState *st) {
     }
 
     switch (symbol) {
-      case anon_sym_AT: fprintf(st->outfile, "@"); break;
-      case anon_sym_LBRACK: fprintf(st->outfile, "["); break;
-      case anon_sym_RBRACK: fprintf(st->outfile, "]"); break;
+      case anon_sym_AT: print_literal("@", st); break;
+      case anon_sym_LBRACK: print_literal("[", st); break;
+      case anon_sym_RBRACK: print_literal("]", st); break;
     }
   }
 }
 
 void print_typed_identifier_list(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
 
     switch (symbol) {
       case anon_sym_COMMA:
-        fprintf(st->outfile, ", ");
+        print_literal(", ", st);
         break;
       case sym_typed_identifier:
         print_typed_identifier(child, st);
@@ -2551,195 +2498,95 @@ void print_typed_identifier_list(TSNode node, PrpfmtState *st) {
 }
 
 void print_unary_expression(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
-    const char *field_name = ts_node_field_name_for_child(node, i);
-
-    if (field_name) {
-      if (strcmp(field_name, "operator") == 0) {
-        char *text = get_node_text(child, st->source_code);
-        if (text) {
-          fprintf(st->outfile, "%s", text);
-          if (strcmp(text, "not") == 0) {
-            fprintf(st->outfile, " ");
-          }
-          free(text);
-        }
-        continue;
-      }
-      if (strcmp(field_name, "argument") == 0) {
-        print__expression(child, st);
-        continue;
-      }
-    }
-  }
+  print_operator_chain(node, st);
 }
 
 void print_unsized_integer_type(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_var_or_let_or_reg(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print_when_unless_cond(TSNode node, PrpfmtState *st) {
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; i++) {
-    TSNode child = ts_node_child(node, i);
+  (void)node;
+  for (TSNode child = cursor_first_child(st); !ts_node_is_null(child); child = cursor_next_sibling(st)) {
     TSSymbol symbol = ts_node_grammar_symbol(child);
-    const char *field_name = ts_node_field_name_for_child(node, i);
+    TSFieldId field = ts_tree_cursor_current_field_id(&st->cursor);
 
-    if (field_name && strcmp(field_name, "condition") == 0) {
-      fprintf(st->outfile, " ");
+    if (field == field_condition) {
+      print_literal(" ", st);
       print__expression(child, st);
       continue;
     }
 
     if (symbol == anon_sym_when) {
-      fprintf(st->outfile, "when");
+      print_literal("when", st);
     } else if (symbol == anon_sym_unless) {
-      fprintf(st->outfile, "unless");
+      print_literal("unless", st);
     }
   }
 }
 
 void print__binary_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__bool_literal(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__decimal_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
+// Past PRPFMT_MAX_NESTING the subtree is copied as written instead of
+// recursing further (the known limitation described in prpfmt.h)
 void print__expression(TSNode node, PrpfmtState *st) {
-  TSSymbol symbol = ts_node_grammar_symbol(node);
-
-  switch (symbol) {
-    case sym_binary_expression:
-      print_binary_expression(node, st);
-      break;
-    case sym_if_expression:
-      print_if_expression(node, st);
-      break;
-    case sym_match_expression:
-      print_match_expression(node, st);
-      break;
-    case sym_type_specification:
-      print_type_specification(node, st);
-      break;
-    case sym_unary_expression:
-      print_unary_expression(node, st);
-      break;
-    case sym_complex_identifier:
-    case sym_constant:
-    case sym_function_call_expression:
-    case sym_lambda:
-    case sym_tuple:
-    case sym_optional_expression:
-    case sym__restricted_expression:
-    default:
-      print__restricted_expression(node, st);
-      break;
+  if (st->nesting >= PRPFMT_MAX_NESTING) {
+    print_node_text(node, st);
+    return;
   }
+  st->nesting++;
+  print_node(node, st);
+  st->nesting--;
 }
 
 void print__expression_with_comprehension(TSNode node, PrpfmtState *st) {
-  TSSymbol symbol = ts_node_grammar_symbol(node);
-  if (symbol == sym_for_comprehension) {
-    print_for_comprehension(node, st);
-  } else {
-    print__expression(node, st);
-  }
+  print__expression(node, st);
 }
 
 void print__hex_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__neg_binary_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__neg_decimal_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__neg_hex_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__neg_octal_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__neg_scaled_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__neg_simple_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__neg_typed_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__number(TSNode node, PrpfmtState *st) {
@@ -2790,71 +2637,22 @@ void print__number(TSNode node, PrpfmtState *st) {
       break;
     default:
       if (ts_node_child_count(node) == 0) {
-        char *text = get_node_text(node, st->source_code);
-        if (text) {
-          fprintf(st->outfile, "%s", text);
-          free(text);
-        }
+        print_node_text(node, st);
       }
       break;
   }
 }
 
 void print__octal_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__restricted_expression(TSNode node, PrpfmtState *st) {
-  TSSymbol symbol = ts_node_grammar_symbol(node);
-
-  switch (symbol) {
-    case sym_complex_identifier:
-      print_complex_identifier(node, st);
-      break;
-    case sym_constant:
-      print_constant(node, st);
-      break;
-    case sym_function_call_expression:
-      print_function_call_expression(node, st);
-      break;
-    case sym_lambda:
-      print_lambda(node, st);
-      break;
-    case sym_tuple:
-      print_tuple(node, st);
-      break;
-    case sym_optional_expression:
-      print_optional_expression(node, st);
-      break;
-    case sym_if_expression:
-      print_if_expression(node, st);
-      break;
-    case sym_match_expression:
-      print_match_expression(node, st);
-      break;
-    default:
-      // Fallback: print node text if it's a leaf or we don't have a specific handler
-      if (ts_node_child_count(node) == 0) {
-        char *text = get_node_text(node, st->source_code);
-        if (text) {
-          fprintf(st->outfile, "%s", text);
-          free(text);
-        }
-      }
-      break;
-  }
+  print_node(node, st);
 }
 
 void print__scaled_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__semicolon(TSNode node, PrpfmtState *st) {
@@ -2862,33 +2660,26 @@ void print__semicolon(TSNode node, PrpfmtState *st) {
 
   switch (symbol) {
     case anon_sym_SEMI:
-      fprintf(st->outfile, " ;");
+      print_literal(" ;", st);
       break;
     case sym_when_unless_cond:
-      fprintf(st->outfile, " ");
+      print_literal(" ", st);
       print_when_unless_cond(node, st);
       break;
   }
 }
 
 void print__simple_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__simple_string_literal(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__space(TSNode node, PrpfmtState *st) {
-    fprintf(st->outfile, "_space\n");
+  (void)node;
+    print_literal("_space\n", st);
 }
 
 void print__string_literal(TSNode node, PrpfmtState *st) {
@@ -2902,73 +2693,24 @@ void print__string_literal(TSNode node, PrpfmtState *st) {
 }
 
 void print__timing_sequence(TSNode node, PrpfmtState *st) {
-    fprintf(st->outfile, "_timing_sequence\n");
+  (void)node;
+    print_literal("_timing_sequence\n", st);
 }
 
 void print__tuple_item(TSNode node, PrpfmtState *st) {
-  TSSymbol symbol = ts_node_grammar_symbol(node);
-
-  switch (symbol) {
-    case sym_ref_identifier:
-      print_ref_identifier(node, st);
-      break;
-    case sym_assignment:
-      print_assignment(node, st);
-      break;
-    case sym_typed_declaration:
-      print_typed_declaration(node, st);
-      break;
-    case sym_lambda:
-      print_lambda(node, st);
-      break;
-    default:
-      print__expression_with_comprehension(node, st);
-      break;
-  }
+  print__expression(node, st);
 }
 
 void print__type(TSNode node, PrpfmtState *st) {
-  TSSymbol symbol = ts_node_grammar_symbol(node);
-
-  switch (symbol) {
-    case sym_primitive_type:
-      print_primitive_type(node, st);
-      break;
-    case sym_array_type:
-      print_array_type(node, st);
-      break;
-    case sym_lambda:
-      print_lambda(node, st);
-      break;
-    case sym_expression_type:
-      print_expression_type(node, st);
-      break;
-    default:
-      if (ts_node_child_count(node) == 0) {
-        char *text = get_node_text(node, st->source_code);
-        if (text) {
-          fprintf(st->outfile, "%s", text);
-          free(text);
-        }
-      }
-      break;
-  }
+  print_node(node, st);
 }
 
 void print__typed_number(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 void print__unknown_literal(TSNode node, PrpfmtState *st) {
-  char *text = get_node_text(node, st->source_code);
-  if (text) {
-    fprintf(st->outfile, "%s", text);
-    free(text);
-  }
+  print_node_text(node, st);
 }
 
 
@@ -2986,60 +2728,63 @@ char *get_node_text(TSNode node, const char *source_code) {
   }
 
   // Retrieve original text
-  strncpy(text, source_code + start_byte, length);
+  memcpy(text, source_code + start_byte, length);
   text[length] = '\0';
 
   return text;
 }
 
-void format_node_recursive(TSNode node, const char *source_code, uint32_t *last_printed_end, FILE *outfile) {
-  // Only print if leaf node
-  if (ts_node_child_count(node) == 0) {
-    uint32_t start_byte = ts_node_start_byte(node);
-    // Preserve whitespace between last printed node and current node
-    for (uint32_t i = *last_printed_end; i < start_byte; ++i) {
-      fprintf(outfile, "%c", source_code[i]);
-    }
+void format_node_leaves(TSNode node, const char *source_code, uint32_t *last_printed_end, PrpfmtSink *out) {
+  // Pre-order walk with one cursor; only leaves are printed
+  TSTreeCursor cursor = ts_tree_cursor_new(node);
+  for (;;) {
+    TSNode current = ts_tree_cursor_current_node(&cursor);
+    if (ts_node_child_count(current) == 0) {
+      uint32_t start_byte = ts_node_start_byte(current);
+      // Preserve whitespace between last printed node and current node
+      if (start_byte > *last_printed_end) {
+        prpfmt_sink_write(out, source_code + *last_printed_end, start_byte - *last_printed_end);
+      }
 
-    // Get node text and update node pointer
-    char *node_text = get_node_text(node, source_code);
-    if (node_text) {
-      fprintf(outfile, "%s", node_text);
-      free(node_text);
+      // Print node text straight from the source and update node pointer
+      uint32_t end_byte = ts_node_end_byte(current);
+      prpfmt_sink_write(out, source_code + start_byte, end_byte - start_byte);
+      *last_printed_end = end_byte;
     }
-    *last_printed_end = ts_node_end_byte(node);
-  }
-
-  TSTreeCursor cursor = ts_tree_cursor_new(node);
 
-  // Recursively traverse child nodes
-  if (ts_tree_cursor_goto_first_child(&cursor)) {
-    do {
-      TSNode current_child_node = ts_tree_cursor_current_node(&cursor);
-      format_node_recursive(current_child_node, source_code, last_printed_end,
-                         outfile);
-    } while (ts_tree_cursor_goto_next_sibling(&cursor));
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+    }
   }
-
-  ts_tree_cursor_delete(&cursor);
 }
 
-// Helper for test_print_all_nodes
-void test_print_all_nodes_recursive(TSNode node, const char *source_code, int indent_level) {
-  for (int i = 0; i < indent_level; ++i) {
-    printf("  ");
-  }
-  printf("Node Type: %s\n", ts_node_type(node));
+// Test function to print all nodes, indented by depth
+void test_print_all_nodes(TSTree *tree, const char *source_code) {
+  (void)source_code;
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  uint32_t depth = 0;
+  for (;;) {
+    for (uint32_t i = 0; i < depth; ++i) {
+      printf("  ");
+    }
+    printf("Node Type: %s\n", ts_node_type(ts_tree_cursor_current_node(&cursor)));
 
-  uint32_t child_count = ts_node_child_count(node);
-  for (uint32_t i = 0; i < child_count; ++i) {
-    TSNode child = ts_node_child(node, i);
-    test_print_all_nodes_recursive(child, source_code, indent_level + 1);
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      depth++;
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+      depth--;
+    }
   }
 }
-
-// Test function to print all nodes
-void test_print_all_nodes(TSTree *tree, const char *source_code) {
-  TSNode root_node = ts_tree_root_node(tree);
-  test_print_all_nodes_recursive(root_node, source_code, 0);
-}
@@ -1,15 +1,110 @@
 #ifndef PRP_FMT_H
 #define PRP_FMT_H
 
+#include <stdatomic.h>
 #include <stdio.h>
+#include <string.h>
 #include <tree_sitter/api.h>
 
+// Formatted text is staged in a block buffer and handed to the backing
+// store in large writes. A memory sink keeps the whole output in buffer.
+#define PRPFMT_SINK_BLOCK_SIZE (1 << 16)
+
+typedef enum {
+  PRPFMT_SINK_MEMORY,
+  PRPFMT_SINK_FD,
+  PRPFMT_SINK_CALLBACK,
+} PrpfmtSinkKind;
+
+typedef void (*PrpfmtWriteFn)(void *payload, const char *data, size_t length);
+
+typedef struct {
+  PrpfmtSinkKind kind;
+  char *buffer;
+  size_t length;
+  size_t capacity;
+  int fd;
+  PrpfmtWriteFn write_fn;
+  void *payload;
+  bool failed;
+} PrpfmtSink;
+
+void prpfmt_sink_init_memory(PrpfmtSink *sink);
+void prpfmt_sink_init_fd(PrpfmtSink *sink, int fd);
+void prpfmt_sink_init_callback(PrpfmtSink *sink, PrpfmtWriteFn write_fn, void *payload);
+void prpfmt_sink_write_slow(PrpfmtSink *sink, const char *data, size_t length);
+bool prpfmt_sink_flush(PrpfmtSink *sink);
+bool prpfmt_sink_destroy(PrpfmtSink *sink);
+
+static inline void prpfmt_sink_write(PrpfmtSink *sink, const char *data, size_t length) {
+  if (length <= sink->capacity - sink->length) {
+    memcpy(sink->buffer + sink->length, data, length);
+    sink->length += length;
+  } else {
+    prpfmt_sink_write_slow(sink, data, length);
+  }
+}
+
+// Source text of one input. Regular files are mapped read-only; pipes and
+// stdin ("-") are read into a heap buffer. data is not NUL-terminated.
+typedef struct {
+  const char *data;
+  uint32_t length;
+  size_t mapped_size;
+  char *owned;
+} PrpfmtInput;
+
+int prpfmt_input_open(PrpfmtInput *input, const char *path);
+void prpfmt_input_close(PrpfmtInput *input);
+
+// Parse budget for untrusted input. A parse stops once timeout_micros have
+// passed since prpfmt_budget_start (0: no limit) or once *cancel is set
+// from any thread (NULL: not cancellable). prpfmt_parse returns NULL with
+// *status saying why and resets the parser, which is ready for the next
+// input. A budget started once covers every parse until it is started
+// again.
+typedef enum {
+  PRPFMT_PARSE_OK,
+  PRPFMT_PARSE_TIMED_OUT,
+  PRPFMT_PARSE_CANCELLED,
+} PrpfmtParseStatus;
+
+typedef struct {
+  uint64_t timeout_micros;
+  const atomic_bool *cancel;
+  uint64_t deadline;  // monotonic microseconds, set by prpfmt_budget_start
+} PrpfmtParseBudget;
+
+void prpfmt_budget_start(PrpfmtParseBudget *budget);
+TSTree *prpfmt_parse(TSParser *parser, const TSTree *old_tree, TSInput input, const PrpfmtParseBudget *budget,
+                     PrpfmtParseStatus *status);
+TSTree *prpfmt_parse_string(TSParser *parser, const TSTree *old_tree, const char *source, uint32_t length,
+                            const PrpfmtParseBudget *budget, PrpfmtParseStatus *status);
+const char *prpfmt_parse_status_message(PrpfmtParseStatus status);
+
+// Printers share one tree cursor. Each print_* function is entered with
+// the cursor on the node it prints and returns with it there again.
+// Statements and expressions nested deeper than PRPFMT_MAX_NESTING are
+// copied as written, which bounds the printers' C stack; operator chains
+// do not count towards it (see print_operator_chain).
+//
+// Known limitation: only operator chains are printed without recursion.
+// Every other construct (tuples, calls, blocks, if/match, lambdas) recurses
+// through print_statement and print__expression, so a subtree nested past
+// the cap is left unformatted: its text is kept byte for byte, while the
+// code around it is formatted as usual.
+#define PRPFMT_MAX_NESTING 512
+
 typedef struct {
   const char *source_code;
-  FILE *outfile;
+  PrpfmtSink *out;
   int indent_level;
   int indent_size;
   bool fmt_on;
+  uint32_t nesting;
+  TSTreeCursor cursor;
+  TSTreeCursor lookahead;
+  TSNode prev_sibling;
 } PrpfmtState;
 
 // Symbol enum from tree-sitter-pyrope/src/parser.c
@@ -254,9 +349,325 @@ enum {
   aux_sym_complex_string_literal_repeat1 = 238,
 };
 
+#define PRPFMT_SYMBOL_COUNT 239
+
+// Symbol-to-printer dispatch, generated by gen_dispatch.py into
+// prpfmt_dispatch.c. prpfmt_printers[symbol] is print_<type> for every named
+// node type that has a printer and NULL otherwise; prpfmt_layout[symbol]
+// says how print_statement lays it out. Symbols outside the tables (ERROR)
+// have neither.
+typedef void (*PrpfmtPrinter)(TSNode node, PrpfmtState *st);
+
+enum {
+  PRPFMT_LAYOUT_STATEMENT = 1 << 0,   // a child of statement: indented, ends the line
+  PRPFMT_LAYOUT_EXTRA = 1 << 1,       // may appear anywhere (comments)
+  PRPFMT_LAYOUT_OWN_INDENT = 1 << 2,  // prints its own indentation
+};
+
+extern const PrpfmtPrinter prpfmt_printers[PRPFMT_SYMBOL_COUNT];
+extern const uint8_t prpfmt_layout[PRPFMT_SYMBOL_COUNT];
+
+static inline PrpfmtPrinter prpfmt_printer(TSSymbol symbol) {
+  return symbol < PRPFMT_SYMBOL_COUNT ? prpfmt_printers[symbol] : NULL;
+}
+
+static inline uint8_t prpfmt_symbol_layout(TSSymbol symbol) {
+  return symbol < PRPFMT_SYMBOL_COUNT ? prpfmt_layout[symbol] : 0;
+}
+
+// Field ids from tree-sitter-pyrope, resolved once by prpfmt_init()
+#define PRPFMT_NO_FIELD ((TSFieldId)-1)
+
+extern TSFieldId field_alias;
+extern TSFieldId field_args;
+extern TSFieldId field_argument;
+extern TSFieldId field_attribute;
+extern TSFieldId field_attributes;
+extern TSFieldId field_base;
+extern TSFieldId field_body;
+extern TSFieldId field_capture;
+extern TSFieldId field_code;
+extern TSFieldId field_condition;
+extern TSFieldId field_constrained;
+extern TSFieldId field_data;
+extern TSFieldId field_decl;
+extern TSFieldId field_definition;
+extern TSFieldId field_delay;
+extern TSFieldId field_func_type;
+extern TSFieldId field_function;
+extern TSFieldId field_generic;
+extern TSFieldId field_identifier;
+extern TSFieldId field_implementation;
+extern TSFieldId field_index;
+extern TSFieldId field_init;
+extern TSFieldId field_input;
+extern TSFieldId field_left;
+extern TSFieldId field_length;
+extern TSFieldId field_lvalue;
+extern TSFieldId field_match_list;
+extern TSFieldId field_mod;
+extern TSFieldId field_module;
+extern TSFieldId field_name;
+extern TSFieldId field_operator;
+extern TSFieldId field_output;
+extern TSFieldId field_pipe_config;
+extern TSFieldId field_right;
+extern TSFieldId field_rvalue;
+extern TSFieldId field_select;
+extern TSFieldId field_timing;
+extern TSFieldId field_trait_name;
+extern TSFieldId field_type;
+extern TSFieldId field_type_name;
+extern TSFieldId field_values;
+extern TSFieldId field_verification;
+
+void prpfmt_init(const TSLanguage *language);
+
 void print_tree(TSTree *tree, PrpfmtState *st);
 
-void check_format_directives(const char *node_text, PrpfmtState *st);
+// A replacement of [start_byte, end_byte) in the current source with text.
+// Edit lists are sorted by start_byte and never overlap.
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  char *text;
+  uint32_t length;
+} PrpfmtTextEdit;
+
+// Incremental formatting for editors. Applies edits to old_tree, reparses
+// source against it and reformats only the top-level statements touched by
+// the edits or by the changed ranges of the reparse. prpfmt on/off
+// directives are honoured at any depth; an edit that touches a comment or a
+// directive reformats every statement. Returns the new tree, or NULL on
+// failure; old_tree is still owned by the caller.
+TSTree *prpfmt_format_incremental(TSParser *parser, TSTree *old_tree,
+                                  const TSInputEdit *edits, uint32_t edit_count,
+                                  const char *source, uint32_t length,
+                                  PrpfmtTextEdit **text_edits, uint32_t *text_edit_count);
+void prpfmt_text_edits_free(PrpfmtTextEdit *text_edits, uint32_t count);
+
+// prpfmt on/off directives of one tree: the comments that switch
+// formatting, in source order, as check_format_directives reads them. Built
+// once per tree, so a range format looks up the state at its first
+// statement with a binary search instead of scanning the prefix.
+typedef struct {
+  uint32_t end_byte;  // of the comment
+  bool fmt_on;
+} PrpfmtDirective;
+
+typedef struct {
+  PrpfmtDirective *directives;
+  uint32_t count;
+} PrpfmtDirectiveIndex;
+
+bool prpfmt_directives_build(TSTree *tree, const char *source, PrpfmtDirectiveIndex *index);
+bool prpfmt_directives_fmt_on(const PrpfmtDirectiveIndex *index, uint32_t offset);
+void prpfmt_directives_free(PrpfmtDirectiveIndex *index);
+
+// Range formatting. Formats the statements covering [start_byte, end_byte),
+// widened to the nearest siblings that enclose it, with the indent level
+// they inherit from their ancestors and the prpfmt on/off state that
+// directives holds for them. Returns false if the range holds no complete
+// statement or it has parse errors; otherwise *text_edit (freed by the
+// caller) is the replacement to splice into the source.
+bool prpfmt_format_range(TSTree *tree, const char *source, const PrpfmtDirectiveIndex *directives,
+                         uint32_t start_byte, uint32_t end_byte, PrpfmtTextEdit *text_edit);
+bool prpfmt_line_range(const char *source, uint32_t length, uint32_t first_line, uint32_t last_line,
+                       uint32_t *start_byte, uint32_t *end_byte);
+
+// Streaming mode for very large inputs. Reads fd in chunks, cuts the input
+// at line breaks between top-level statements and formats each run of
+// complete statements as soon as it is read, flushing out after each one.
+// Peak memory is bounded by the unfinished tail, not the whole input.
+// budget (may be NULL) is restarted for every window's parse, so the limit
+// applies per window and time spent waiting for input does not count.
+typedef enum {
+  PRPFMT_STREAM_OK,
+  PRPFMT_STREAM_READ_ERROR,
+  PRPFMT_STREAM_PARSE_ERROR,
+  PRPFMT_STREAM_WRITE_ERROR,
+  PRPFMT_STREAM_TIMED_OUT,
+  PRPFMT_STREAM_CANCELLED,
+} PrpfmtStreamStatus;
+
+PrpfmtStreamStatus prpfmt_format_stream(TSParser *parser, int fd, PrpfmtSink *out, PrpfmtParseBudget *budget);
+
+// Parse cache for batch tools. A cache entry holds the syntax tree of one
+// source as a flat node table, keyed by a hash of the source and of the
+// grammar (ABI version, symbols, fields, parse states and the hash of
+// src/parser.c stamped at build time), so any grammar change misses.
+// Entries are mapped read-only when loaded; unchanged files skip parsing.
+//
+// Nodes are stored in pre-order, anonymous nodes included: the first child
+// of node i is i + 1, the others follow through next_sibling. An entry may
+// also carry the prpfmt output for the source.
+#define PRPFMT_CACHE_NONE UINT32_MAX
+
+// Generated at build time by build_hash.cmake. prpfmt_parser_hash is a hash
+// of src/parser.c and is part of the grammar key. prpfmt_output_version is
+// derived from the printer sources (prpfmt.h, prpfmt.c, prpfmt_dispatch.c)
+// and stored with cached output; the output is only used when the loading
+// build has the same prpfmt_output_version.
+extern const uint64_t prpfmt_parser_hash;
+extern const uint64_t prpfmt_output_version;
+
+enum {
+  PRPFMT_CACHE_NAMED = 1 << 0,
+  PRPFMT_CACHE_EXTRA = 1 << 1,
+  PRPFMT_CACHE_ERROR = 1 << 2,
+  PRPFMT_CACHE_MISSING = 1 << 3,
+  PRPFMT_CACHE_HAS_ERROR = 1 << 4,
+};
+
+typedef struct {
+  TSSymbol symbol;          // ts_node_symbol (aliases applied)
+  TSSymbol grammar_symbol;  // ts_node_grammar_symbol
+  TSFieldId field_id;       // field of the node in its parent, or 0
+  uint16_t flags;
+  uint32_t start_byte;
+  uint32_t end_byte;
+  uint32_t parent;
+  uint32_t next_sibling;
+  uint32_t child_count;
+} PrpfmtCacheNode;
+
+typedef struct {
+  const PrpfmtCacheNode *nodes;
+  uint32_t node_count;
+  const char *formatted;  // NULL if the entry has no prpfmt output
+  uint32_t formatted_length;
+  void *mapping;
+  size_t mapped_size;
+  PrpfmtCacheNode *owned;
+} PrpfmtCacheEntry;
+
+bool prpfmt_cache_build(TSTree *tree, PrpfmtCacheEntry *entry);
+bool prpfmt_cache_load(const char *dir, const TSLanguage *language, const char *source, uint32_t length,
+                       PrpfmtCacheEntry *entry);
+bool prpfmt_cache_store(const char *dir, const TSLanguage *language, const char *source, uint32_t length,
+                        const PrpfmtCacheEntry *entry);
+void prpfmt_cache_close(PrpfmtCacheEntry *entry);
+
+// Hash of the ABI version, the symbol and field names and the state count of
+// language, and of the src/parser.c this library was built with
+uint64_t prpfmt_grammar_hash(const TSLanguage *language);
+
+// Flat struct-of-arrays export of a syntax tree for downstream compilers.
+// Node i of every array is the same node; nodes are in pre-order with
+// anonymous nodes included, so node 0 is the root and a subtree is the
+// index range [i, next_sibling) of its root. symbol holds the grammar
+// symbols of the enum above (aliases not applied), field the field id of
+// the node in its parent (0 if none). Missing links are PRPFMT_FLAT_NONE.
+//
+// prpfmt_flat_write stores the arrays in a binary file that
+// prpfmt_flat_read maps back read-only without copying; the file is only
+// read back by the grammar that wrote it.
+#define PRPFMT_FLAT_NONE UINT32_MAX
+
+enum {
+  PRPFMT_FLAT_NAMED = 1 << 0,
+  PRPFMT_FLAT_EXTRA = 1 << 1,
+  PRPFMT_FLAT_ERROR = 1 << 2,
+  PRPFMT_FLAT_MISSING = 1 << 3,
+};
+
+typedef struct {
+  uint32_t node_count;
+  uint32_t capacity;
+  TSSymbol *symbol;
+  TSFieldId *field;
+  uint16_t *flags;
+  uint32_t *parent;
+  uint32_t *first_child;
+  uint32_t *next_sibling;
+  uint32_t *start_byte;
+  uint32_t *end_byte;
+  void *block;
+  size_t mapped_size;  // 0 when block is a heap allocation
+} PrpfmtFlatTree;
+
+bool prpfmt_flat_build(TSTree *tree, PrpfmtFlatTree *flat);
+bool prpfmt_flat_write(const PrpfmtFlatTree *flat, const TSLanguage *language, const char *path);
+bool prpfmt_flat_read(PrpfmtFlatTree *flat, const TSLanguage *language, const char *path);
+void prpfmt_flat_free(PrpfmtFlatTree *flat);
+
+// Registry of the queries in queries/*.scm. The query text is compiled into
+// the library, and each query is compiled with ts_query_new the first time
+// it is requested and then shared by every thread for the life of the
+// process. A TSQuery is read-only once built; each thread runs it with its
+// own TSQueryCursor and must not call ts_query_disable_* on it.
+// prpfmt_query returns NULL if the query does not compile against the
+// grammar; prpfmt_query_error then gives the byte offset and the reason.
+typedef enum {
+  PRPFMT_QUERY_HIGHLIGHTS,
+  PRPFMT_QUERY_FOLDS,
+  PRPFMT_QUERY_INDENTS,
+  PRPFMT_QUERY_COUNT,
+} PrpfmtQueryKind;
+
+const TSQuery *prpfmt_query(PrpfmtQueryKind kind);
+TSQueryError prpfmt_query_error(PrpfmtQueryKind kind, uint32_t *offset);
+const char *prpfmt_query_name(PrpfmtQueryKind kind);
+const char *prpfmt_query_source(PrpfmtQueryKind kind, uint32_t *length);
+
+// Batch highlighter on the highlights query. prpfmt_highlight runs the query
+// over a tree with the highlighter's one reused TSQueryCursor, applies the
+// text predicates (#eq?, #any-of?, #match?, #contains? and their #not-
+// forms) and leaves the spans in spans, sorted by start byte and, for equal
+// starts, outermost first. Spans may nest; when two patterns capture the
+// same range only the later pattern's span is kept, as in the editors the
+// queries are written for. capture indexes ts_query_capture_name_for_id.
+// capture_count is the number of captures that passed the predicates,
+// before overlapping spans were dropped.
+//
+// prpfmt_highlighter_init_query highlights with another query instead,
+// e.g. one pattern compiled alone to time it; query must outlive hl.
+typedef struct {
+  uint32_t start_byte;
+  uint32_t end_byte;
+  uint16_t capture;
+  uint16_t pattern;
+} PrpfmtSpan;
+
+typedef struct PrpfmtPredicate PrpfmtPredicate;
+
+typedef struct {
+  const TSQuery *query;
+  TSQueryCursor *cursor;
+  PrpfmtPredicate *predicates;
+  uint32_t *pattern_predicates;  // first predicate of each pattern, plus an end entry
+  PrpfmtSpan *spans;
+  uint32_t span_count;
+  uint32_t span_capacity;
+  uint32_t capture_count;
+} PrpfmtHighlighter;
+
+bool prpfmt_highlighter_init(PrpfmtHighlighter *hl);
+bool prpfmt_highlighter_init_query(PrpfmtHighlighter *hl, const TSQuery *query);
+bool prpfmt_highlight(PrpfmtHighlighter *hl, TSTree *tree, const char *source);
+void prpfmt_highlighter_destroy(PrpfmtHighlighter *hl);
+
+// Child iteration on st->cursor. cursor_next_sibling returns a null node
+// and moves back to the parent after the last child, so a loop that runs
+// to completion leaves the cursor where it started.
+TSNode cursor_first_child(PrpfmtState *st);
+TSNode cursor_next_sibling(PrpfmtState *st);
+TSNode cursor_peek_next_sibling(PrpfmtState *st);
+
+// Source text output: write slices of source_code without copying them out
+static inline void print_slice(const char *text, uint32_t length, PrpfmtState *st) {
+  prpfmt_sink_write(st->out, text, length);
+}
+
+static inline void print_literal(const char *text, PrpfmtState *st) {
+  prpfmt_sink_write(st->out, text, strlen(text));
+}
+
+void print_indent(PrpfmtState *st);
+void print_node_text(TSNode node, PrpfmtState *st);
+bool node_text_equals(TSNode node, const char *text, PrpfmtState *st);
+
+void check_format_directives(TSNode node, PrpfmtState *st);
 
 void print_comment(TSNode node, PrpfmtState *st);
 
@@ -384,13 +795,13 @@ void print__type(TSNode node, PrpfmtState *st);
 void print__typed_number(TSNode node, PrpfmtState *st);
 void print__unknown_literal(TSNode node, PrpfmtState *st);
 
-// Get node text from source code
+// Get an owned (malloc'd) copy of the node text; printers use print_node_text
 char *get_node_text(TSNode node, const char *source_code);
 
-void format_node_recursive(TSNode node, const char *source_code, uint32_t *last_printed_end, FILE *outfile);
+// Copy the leaves under node to out, with the source between them
+void format_node_leaves(TSNode node, const char *source_code, uint32_t *last_printed_end, PrpfmtSink *out);
 
 // Test functions
 void test_print_all_nodes(TSTree *tree, const char *source_code);
-void test_print_all_nodes_recursive(TSNode node, const char *source_code, int indent_level);
 
 #endif // PRP_FMT_H
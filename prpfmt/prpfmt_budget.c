@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+
+#include "prpfmt.h"
+
+static uint64_t now_micros(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+void prpfmt_budget_start(PrpfmtParseBudget *budget) {
+  budget->deadline = budget->timeout_micros ? now_micros() + budget->timeout_micros : 0;
+}
+
+typedef struct {
+  const PrpfmtParseBudget *budget;
+  PrpfmtParseStatus status;
+} BudgetCheck;
+
+// Called by the runtime every few hundred parse steps; returning true
+// stops the parse
+static bool budget_exceeded(TSParseState *state) {
+  BudgetCheck *check = state->payload;
+  const PrpfmtParseBudget *budget = check->budget;
+  if (budget->cancel && atomic_load_explicit(budget->cancel, memory_order_relaxed)) {
+    check->status = PRPFMT_PARSE_CANCELLED;
+    return true;
+  }
+  if (budget->deadline && now_micros() >= budget->deadline) {
+    check->status = PRPFMT_PARSE_TIMED_OUT;
+    return true;
+  }
+  return false;
+}
+
+TSTree *prpfmt_parse(TSParser *parser, const TSTree *old_tree, TSInput input, const PrpfmtParseBudget *budget,
+                     PrpfmtParseStatus *status) {
+  *status = PRPFMT_PARSE_OK;
+  if (!budget || (!budget->deadline && !budget->cancel)) {
+    return ts_parser_parse(parser, old_tree, input);
+  }
+
+  BudgetCheck check = {.budget = budget, .status = PRPFMT_PARSE_OK};
+  TSParseOptions options = {.payload = &check, .progress_callback = budget_exceeded};
+  TSTree *tree = ts_parser_parse_with_options(parser, old_tree, input, options);
+  if (!tree) {
+    // An aborted parse is kept for resumption; drop it, the next parse is
+    // of another input
+    ts_parser_reset(parser);
+    *status = check.status != PRPFMT_PARSE_OK ? check.status : PRPFMT_PARSE_CANCELLED;
+  }
+  return tree;
+}
+
+typedef struct {
+  const char *source;
+  uint32_t length;
+} StringInput;
+
+static const char *string_read(void *payload, uint32_t byte_index, TSPoint position, uint32_t *bytes_read) {
+  (void)position;
+  const StringInput *string = payload;
+  if (byte_index >= string->length) {
+    *bytes_read = 0;
+    return "";
+  }
+  *bytes_read = string->length - byte_index;
+  return string->source + byte_index;
+}
+
+TSTree *prpfmt_parse_string(TSParser *parser, const TSTree *old_tree, const char *source, uint32_t length,
+                            const PrpfmtParseBudget *budget, PrpfmtParseStatus *status) {
+  if (!budget || (!budget->deadline && !budget->cancel)) {
+    *status = PRPFMT_PARSE_OK;
+    return ts_parser_parse_string(parser, old_tree, source, length);
+  }
+  StringInput string = {source, length};
+  TSInput input = {.payload = &string, .read = string_read, .encoding = TSInputEncodingUTF8};
+  return prpfmt_parse(parser, old_tree, input, budget, status);
+}
+
+const char *prpfmt_parse_status_message(PrpfmtParseStatus status) {
+  switch (status) {
+    case PRPFMT_PARSE_TIMED_OUT:
+      return "parse aborted: time limit exceeded.";
+    case PRPFMT_PARSE_CANCELLED:
+      return "parse aborted: cancelled.";
+    default:
+      return "";
+  }
+}
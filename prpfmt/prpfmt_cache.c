@@ -0,0 +1,273 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+#define CACHE_MAGIC "PRPCACHE"
+#define CACHE_FORMAT_VERSION 2
+
+// File layout: header, node_count nodes, formatted_length bytes of output
+typedef struct {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t abi_version;
+  uint64_t grammar_hash;
+  uint64_t source_hash;
+  uint64_t output_version;  // prpfmt_output_version of the output, 0 if none
+  uint32_t source_length;
+  uint32_t node_count;
+  uint32_t formatted_length;
+  uint32_t reserved;
+} CacheHeader;
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t length) {
+  const unsigned char *p = data;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ p[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char *text) {
+  return hash_bytes(hash, text ? text : "", text ? strlen(text) + 1 : 1);
+}
+
+// Anything that changes node symbols or field ids changes this hash. Names
+// and counts alone miss a regenerated parser with other precedences or
+// conflicts, so the build-time hash of src/parser.c is folded in as well.
+uint64_t prpfmt_grammar_hash(const TSLanguage *language) {
+  uint32_t counts[4] = {
+    ts_language_abi_version(language),
+    ts_language_symbol_count(language),
+    ts_language_field_count(language),
+    ts_language_state_count(language),
+  };
+  uint64_t hash = hash_bytes(FNV_OFFSET, &prpfmt_parser_hash, sizeof(prpfmt_parser_hash));
+  hash = hash_bytes(hash, counts, sizeof(counts));
+  for (TSSymbol symbol = 0; symbol < counts[1]; symbol++) {
+    hash = hash_string(hash, ts_language_symbol_name(language, symbol));
+  }
+  for (TSFieldId field = 1; field <= counts[2]; field++) {
+    hash = hash_string(hash, ts_language_field_name_for_id(language, field));
+  }
+  return hash;
+}
+
+static char *entry_path(const char *dir, uint64_t source_hash, uint64_t grammar) {
+  size_t size = strlen(dir) + 40;
+  char *path = malloc(size);
+  if (path) {
+    snprintf(path, size, "%s/%016llx-%08x.prpc", dir, (unsigned long long)source_hash,
+             (unsigned)(grammar ^ (grammar >> 32)));
+  }
+  return path;
+}
+
+static bool push_node(PrpfmtCacheEntry *entry, uint32_t *capacity, uint32_t **last_child) {
+  if (entry->node_count < *capacity) {
+    return true;
+  }
+  uint32_t grown = *capacity ? *capacity * 2 : 256;
+  PrpfmtCacheNode *nodes = realloc(entry->owned, grown * sizeof(PrpfmtCacheNode));
+  if (!nodes) {
+    return false;
+  }
+  entry->owned = nodes;
+  entry->nodes = nodes;
+  uint32_t *last = realloc(*last_child, grown * sizeof(uint32_t));
+  if (!last) {
+    return false;
+  }
+  *last_child = last;
+  *capacity = grown;
+  return true;
+}
+
+// Flatten tree into a heap node table
+bool prpfmt_cache_build(TSTree *tree, PrpfmtCacheEntry *entry) {
+  memset(entry, 0, sizeof(*entry));
+  uint32_t capacity = 0;
+  uint32_t *last_child = NULL;
+  uint32_t parent = PRPFMT_CACHE_NONE;
+  bool ok = true;
+
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  for (;;) {
+    if (!push_node(entry, &capacity, &last_child)) {
+      ok = false;
+      break;
+    }
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    uint32_t index = entry->node_count++;
+    entry->owned[index] = (PrpfmtCacheNode){
+      .symbol = ts_node_symbol(node),
+      .grammar_symbol = ts_node_grammar_symbol(node),
+      .field_id = ts_tree_cursor_current_field_id(&cursor),
+      .flags = (ts_node_is_named(node) ? PRPFMT_CACHE_NAMED : 0) |
+               (ts_node_is_extra(node) ? PRPFMT_CACHE_EXTRA : 0) |
+               (ts_node_is_error(node) ? PRPFMT_CACHE_ERROR : 0) |
+               (ts_node_is_missing(node) ? PRPFMT_CACHE_MISSING : 0) |
+               (ts_node_has_error(node) ? PRPFMT_CACHE_HAS_ERROR : 0),
+      .start_byte = ts_node_start_byte(node),
+      .end_byte = ts_node_end_byte(node),
+      .parent = parent,
+      .next_sibling = PRPFMT_CACHE_NONE,
+    };
+    if (parent != PRPFMT_CACHE_NONE) {
+      if (entry->owned[parent].child_count++ > 0) {
+        entry->owned[last_child[parent]].next_sibling = index;
+      }
+      last_child[parent] = index;
+    }
+
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      parent = index;
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        goto done;
+      }
+      parent = entry->owned[parent].parent;
+    }
+  }
+
+done:
+  ts_tree_cursor_delete(&cursor);
+  free(last_child);
+  if (!ok) {
+    prpfmt_cache_close(entry);
+  }
+  return ok;
+}
+
+// Map the entry for source if one exists and was built by this grammar
+bool prpfmt_cache_load(const char *dir, const TSLanguage *language, const char *source, uint32_t length,
+                       PrpfmtCacheEntry *entry) {
+  memset(entry, 0, sizeof(*entry));
+  uint64_t grammar = prpfmt_grammar_hash(language);
+  uint64_t source_hash = hash_bytes(FNV_OFFSET, source, length);
+  char *path = entry_path(dir, source_hash, grammar);
+  if (!path) {
+    return false;
+  }
+  int fd = open(path, O_RDONLY);
+  free(path);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat sb;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(CacheHeader)) {
+    map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const CacheHeader *header = map;
+  uint64_t expected_size = sizeof(CacheHeader) + (uint64_t)header->node_count * sizeof(PrpfmtCacheNode) +
+                           header->formatted_length;
+  if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->format_version != CACHE_FORMAT_VERSION || header->grammar_hash != grammar ||
+      header->source_hash != source_hash || header->source_length != length || header->node_count == 0 ||
+      expected_size != (uint64_t)sb.st_size) {
+    munmap(map, (size_t)sb.st_size);
+    return false;
+  }
+
+  entry->mapping = map;
+  entry->mapped_size = (size_t)sb.st_size;
+  entry->nodes = (const PrpfmtCacheNode *)(header + 1);
+  entry->node_count = header->node_count;
+  if (header->output_version == prpfmt_output_version) {
+    entry->formatted = (const char *)(entry->nodes + entry->node_count);
+    entry->formatted_length = header->formatted_length;
+  }
+  return true;
+}
+
+static bool write_all(int fd, const void *data, size_t length) {
+  const char *p = data;
+  while (length > 0) {
+    ssize_t count = write(fd, p, length);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += count;
+    length -= (size_t)count;
+  }
+  return true;
+}
+
+// Write the entry to a temporary file and rename it into place, so
+// concurrent jobs never see a partial entry
+bool prpfmt_cache_store(const char *dir, const TSLanguage *language, const char *source, uint32_t length,
+                        const PrpfmtCacheEntry *entry) {
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    return false;
+  }
+
+  CacheHeader header = {
+    .magic = CACHE_MAGIC,
+    .format_version = CACHE_FORMAT_VERSION,
+    .abi_version = ts_language_abi_version(language),
+    .grammar_hash = prpfmt_grammar_hash(language),
+    .source_hash = hash_bytes(FNV_OFFSET, source, length),
+    .source_length = length,
+    .node_count = entry->node_count,
+    .formatted_length = entry->formatted ? entry->formatted_length : 0,
+    .output_version = entry->formatted ? prpfmt_output_version : 0,
+  };
+  char *path = entry_path(dir, header.source_hash, header.grammar_hash);
+  size_t tmp_size = strlen(dir) + sizeof("/.prpc.XXXXXX");
+  char *tmp_path = malloc(tmp_size);
+  if (!path || !tmp_path) {
+    free(path);
+    free(tmp_path);
+    return false;
+  }
+  snprintf(tmp_path, tmp_size, "%s/.prpc.XXXXXX", dir);
+
+  bool ok = false;
+  int fd = mkstemp(tmp_path);
+  if (fd >= 0) {
+    // mkstemp creates the file private to this user; caches are shared
+    fchmod(fd, 0644);
+    ok = write_all(fd, &header, sizeof(header)) &&
+         write_all(fd, entry->nodes, entry->node_count * sizeof(PrpfmtCacheNode)) &&
+         write_all(fd, entry->formatted, header.formatted_length);
+    ok = close(fd) == 0 && ok;
+    ok = ok && rename(tmp_path, path) == 0;
+    if (!ok) {
+      unlink(tmp_path);
+    }
+  }
+  free(path);
+  free(tmp_path);
+  return ok;
+}
+
+void prpfmt_cache_close(PrpfmtCacheEntry *entry) {
+  if (entry->mapping) {
+    munmap(entry->mapping, entry->mapped_size);
+  }
+  free(entry->owned);
+  memset(entry, 0, sizeof(*entry));
+}
@@ -0,0 +1,111 @@
+// Generated by gen_dispatch.py from src/node-types.json and prpfmt.h; do not edit.
+
+#include "prpfmt.h"
+
+const PrpfmtPrinter prpfmt_printers[PRPFMT_SYMBOL_COUNT] = {
+  [sym_arg_item] = print_arg_item,
+  [sym_arg_item_list] = print_arg_item_list,
+  [sym_arg_list] = print_arg_list,
+  [sym_array_type] = print_array_type,
+  [sym_assignment] = print_assignment,
+  [sym_assignment_delay] = print_assignment_delay,
+  [sym_assignment_operator] = print_assignment_operator,
+  [sym_assignment_or_declaration_statement] = print_assignment_or_declaration_statement,
+  [sym_attribute_item] = print_attribute_item,
+  [sym_attribute_item_list] = print_attribute_item_list,
+  [sym_attribute_list] = print_attribute_list,
+  [sym_attributes] = print_attributes,
+  [sym_binary_expression] = print_binary_expression,
+  [sym_bit_select] = print_bit_select,
+  [sym_bit_select_type] = print_bit_select_type,
+  [sym_bit_selection] = print_bit_selection,
+  [sym_boolean_type] = print_boolean_type,
+  [sym_bounded_integer_type] = print_bounded_integer_type,
+  [sym_comb_tok] = print_comb_tok,
+  [sym_comment] = print_comment,
+  [sym_complex_identifier] = print_complex_identifier,
+  [sym_complex_string_literal] = print_complex_string_literal,
+  [sym_constant] = print_constant,
+  [sym_control_statement] = print_control_statement,
+  [sym_declaration_statement] = print_declaration_statement,
+  [sym_delay_tok] = print_delay_tok,
+  [sym_dot_expression] = print_dot_expression,
+  [sym_dot_expression_type] = print_dot_expression_type,
+  [sym_enum_assignment] = print_enum_assignment,
+  [sym_enum_assignment_statement] = print_enum_assignment_statement,
+  [sym_enum_definition] = print_enum_definition,
+  [sym_expression_list] = print_expression_list,
+  [sym_expression_statement] = print_expression_statement,
+  [sym_expression_type] = print_expression_type,
+  [sym_flow_tok] = print_flow_tok,
+  [sym_for_comprehension] = print_for_comprehension,
+  [sym_for_statement] = print_for_statement,
+  [sym_function_call_expression] = print_function_call_expression,
+  [sym_function_call_statement] = print_function_call_statement,
+  [sym_function_call_type] = print_function_call_type,
+  [sym_function_definition_decl] = print_function_definition_decl,
+  [sym_identifier] = print_identifier,
+  [sym_if_expression] = print_if_expression,
+  [sym_impl_statement] = print_impl_statement,
+  [sym_import_statement] = print_import_statement,
+  [sym_lambda] = print_lambda,
+  [sym_loop_statement] = print_loop_statement,
+  [sym_lvalue_item] = print_lvalue_item,
+  [sym_lvalue_list] = print_lvalue_list,
+  [sym_match_expression] = print_match_expression,
+  [sym_match_list] = print_match_list,
+  [sym_match_operator] = print_match_operator,
+  [sym_member_select] = print_member_select,
+  [sym_member_selection] = print_member_selection,
+  [sym_module_path] = print_module_path,
+  [sym_optional_expression] = print_optional_expression,
+  [sym_pipe_tok] = print_pipe_tok,
+  [sym_primitive_type] = print_primitive_type,
+  [sym_range_type] = print_range_type,
+  [sym_ref_identifier] = print_ref_identifier,
+  [sym_scope_statement] = print_scope_statement,
+  [sym_select] = print_select,
+  [sym_select_options] = print_select_options,
+  [sym_selection] = print_selection,
+  [sym_sized_integer_type] = print_sized_integer_type,
+  [sym_statement] = print_statement,
+  [sym_stmt_list] = print_stmt_list,
+  [sym_string_type] = print_string_type,
+  [sym_test_statement] = print_test_statement,
+  [sym_timed_identifier] = print_timed_identifier,
+  [sym_tuple] = print_tuple,
+  [sym_tuple_list] = print_tuple_list,
+  [sym_tuple_sq] = print_tuple_sq,
+  [sym_type_cast] = print_type_cast,
+  [sym_type_or_identifier] = print_type_or_identifier,
+  [sym_type_specification] = print_type_specification,
+  [sym_type_statement] = print_type_statement,
+  [sym_type_type] = print_type_type,
+  [sym_typed_declaration] = print_typed_declaration,
+  [sym_typed_identifier] = print_typed_identifier,
+  [sym_typed_identifier_list] = print_typed_identifier_list,
+  [sym_unary_expression] = print_unary_expression,
+  [sym_unsized_integer_type] = print_unsized_integer_type,
+  [sym_var_or_let_or_reg] = print_var_or_let_or_reg,
+  [sym_when_unless_cond] = print_when_unless_cond,
+  [sym_while_statement] = print_while_statement,
+};
+
+const uint8_t prpfmt_layout[PRPFMT_SYMBOL_COUNT] = {
+  [sym_assignment_or_declaration_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_comment] = PRPFMT_LAYOUT_EXTRA,
+  [sym_control_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_declaration_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_enum_assignment_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_expression_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_for_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_function_call_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_impl_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_import_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_lambda] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_loop_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_scope_statement] = PRPFMT_LAYOUT_STATEMENT | PRPFMT_LAYOUT_OWN_INDENT,
+  [sym_test_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_type_statement] = PRPFMT_LAYOUT_STATEMENT,
+  [sym_while_statement] = PRPFMT_LAYOUT_STATEMENT,
+};
@@ -0,0 +1,235 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+#define FLAT_MAGIC "PRPFLAT"
+#define FLAT_FORMAT_VERSION 1
+#define FLAT_ARRAY_COUNT 8
+
+// File layout: header, then the arrays in the order of flat_widths, each
+// padded to 8 bytes. The heap block uses the same layout for its capacity.
+typedef struct {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t node_count;
+  uint64_t grammar_hash;
+} FlatHeader;
+
+static const size_t flat_widths[FLAT_ARRAY_COUNT] = {
+  sizeof(TSSymbol), sizeof(TSFieldId), sizeof(uint16_t), sizeof(uint32_t),
+  sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t),
+};
+
+static size_t array_size(size_t width, uint32_t count) {
+  return (width * count + 7) & ~(size_t)7;
+}
+
+static size_t flat_block_size(uint32_t count) {
+  size_t size = 0;
+  for (int i = 0; i < FLAT_ARRAY_COUNT; i++) {
+    size += array_size(flat_widths[i], count);
+  }
+  return size;
+}
+
+// Point the arrays of flat into block, laid out for count nodes
+static void flat_bind(PrpfmtFlatTree *flat, char *block, uint32_t count) {
+  void **arrays[FLAT_ARRAY_COUNT] = {
+    (void **)&flat->symbol, (void **)&flat->field, (void **)&flat->flags, (void **)&flat->parent,
+    (void **)&flat->first_child, (void **)&flat->next_sibling, (void **)&flat->start_byte,
+    (void **)&flat->end_byte,
+  };
+  for (int i = 0; i < FLAT_ARRAY_COUNT; i++) {
+    *arrays[i] = block;
+    block += array_size(flat_widths[i], count);
+  }
+}
+
+static bool flat_grow(PrpfmtFlatTree *flat) {
+  uint32_t capacity = flat->capacity ? flat->capacity * 2 : 1024;
+  char *block = malloc(flat_block_size(capacity));
+  if (!block) {
+    return false;
+  }
+
+  PrpfmtFlatTree grown = *flat;
+  flat_bind(&grown, block, capacity);
+  if (flat->node_count > 0) {
+    const void *from[FLAT_ARRAY_COUNT] = {
+      flat->symbol, flat->field, flat->flags, flat->parent,
+      flat->first_child, flat->next_sibling, flat->start_byte, flat->end_byte,
+    };
+    void *to[FLAT_ARRAY_COUNT] = {
+      grown.symbol, grown.field, grown.flags, grown.parent,
+      grown.first_child, grown.next_sibling, grown.start_byte, grown.end_byte,
+    };
+    for (int i = 0; i < FLAT_ARRAY_COUNT; i++) {
+      memcpy(to[i], from[i], flat_widths[i] * flat->node_count);
+    }
+  }
+  free(flat->block);
+  grown.block = block;
+  grown.capacity = capacity;
+  *flat = grown;
+  return true;
+}
+
+// One cursor walk over tree. previous is the last node of the current
+// level, whose next_sibling is the next node emitted at that level.
+bool prpfmt_flat_build(TSTree *tree, PrpfmtFlatTree *flat) {
+  memset(flat, 0, sizeof(*flat));
+  uint32_t parent = PRPFMT_FLAT_NONE;
+  uint32_t previous = PRPFMT_FLAT_NONE;
+
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  for (;;) {
+    if (flat->node_count == flat->capacity && !flat_grow(flat)) {
+      ts_tree_cursor_delete(&cursor);
+      prpfmt_flat_free(flat);
+      return false;
+    }
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    uint32_t index = flat->node_count++;
+    flat->symbol[index] = ts_node_grammar_symbol(node);
+    flat->field[index] = ts_tree_cursor_current_field_id(&cursor);
+    flat->flags[index] = (ts_node_is_named(node) ? PRPFMT_FLAT_NAMED : 0) |
+                         (ts_node_is_extra(node) ? PRPFMT_FLAT_EXTRA : 0) |
+                         (ts_node_is_error(node) ? PRPFMT_FLAT_ERROR : 0) |
+                         (ts_node_is_missing(node) ? PRPFMT_FLAT_MISSING : 0);
+    flat->parent[index] = parent;
+    flat->first_child[index] = PRPFMT_FLAT_NONE;
+    flat->next_sibling[index] = PRPFMT_FLAT_NONE;
+    flat->start_byte[index] = ts_node_start_byte(node);
+    flat->end_byte[index] = ts_node_end_byte(node);
+    if (previous != PRPFMT_FLAT_NONE) {
+      flat->next_sibling[previous] = index;
+    } else if (parent != PRPFMT_FLAT_NONE) {
+      flat->first_child[parent] = index;
+    }
+
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      parent = index;
+      previous = PRPFMT_FLAT_NONE;
+      continue;
+    }
+    previous = index;
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return true;
+      }
+      previous = parent;
+      parent = flat->parent[parent];
+    }
+  }
+}
+
+static bool write_all(int fd, const void *data, size_t length) {
+  const char *p = data;
+  while (length > 0) {
+    ssize_t count = write(fd, p, length);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += count;
+    length -= (size_t)count;
+  }
+  return true;
+}
+
+// Write to a temporary file next to path and rename it into place, so a
+// reader never maps a partial file
+bool prpfmt_flat_write(const PrpfmtFlatTree *flat, const TSLanguage *language, const char *path) {
+  size_t tmp_size = strlen(path) + sizeof(".XXXXXX");
+  char *tmp_path = malloc(tmp_size);
+  if (!tmp_path) {
+    return false;
+  }
+  snprintf(tmp_path, tmp_size, "%s.XXXXXX", path);
+  int fd = mkstemp(tmp_path);
+  if (fd < 0) {
+    free(tmp_path);
+    return false;
+  }
+  fchmod(fd, 0644);
+
+  FlatHeader header = {
+    .magic = FLAT_MAGIC,
+    .format_version = FLAT_FORMAT_VERSION,
+    .node_count = flat->node_count,
+    .grammar_hash = prpfmt_grammar_hash(language),
+  };
+  const void *arrays[FLAT_ARRAY_COUNT] = {
+    flat->symbol, flat->field, flat->flags, flat->parent,
+    flat->first_child, flat->next_sibling, flat->start_byte, flat->end_byte,
+  };
+  static const char padding[8];
+  bool ok = write_all(fd, &header, sizeof(header));
+  for (int i = 0; ok && i < FLAT_ARRAY_COUNT; i++) {
+    size_t length = flat_widths[i] * flat->node_count;
+    ok = write_all(fd, arrays[i], length) &&
+         write_all(fd, padding, array_size(flat_widths[i], flat->node_count) - length);
+  }
+  ok = close(fd) == 0 && ok;
+  ok = ok && rename(tmp_path, path) == 0;
+  if (!ok) {
+    unlink(tmp_path);
+  }
+  free(tmp_path);
+  return ok;
+}
+
+// Map path and point the arrays into the mapping
+bool prpfmt_flat_read(PrpfmtFlatTree *flat, const TSLanguage *language, const char *path) {
+  memset(flat, 0, sizeof(*flat));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat sb;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(FlatHeader)) {
+    map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+
+  const FlatHeader *header = map;
+  if (memcmp(header->magic, FLAT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->format_version != FLAT_FORMAT_VERSION || header->grammar_hash != prpfmt_grammar_hash(language) ||
+      sizeof(FlatHeader) + flat_block_size(header->node_count) != (size_t)sb.st_size) {
+    munmap(map, (size_t)sb.st_size);
+    return false;
+  }
+
+  flat_bind(flat, (char *)map + sizeof(FlatHeader), header->node_count);
+  flat->node_count = header->node_count;
+  flat->capacity = header->node_count;
+  flat->block = map;
+  flat->mapped_size = (size_t)sb.st_size;
+  return true;
+}
+
+void prpfmt_flat_free(PrpfmtFlatTree *flat) {
+  if (flat->mapped_size) {
+    munmap(flat->block, flat->mapped_size);
+  } else {
+    free(flat->block);
+  }
+  memset(flat, 0, sizeof(*flat));
+}
@@ -0,0 +1,286 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prpfmt.h"
+
+typedef enum {
+  PREDICATE_EQ,
+  PREDICATE_ANY_OF,
+  PREDICATE_MATCH,
+  PREDICATE_CONTAINS,
+} PredicateKind;
+
+// A text predicate of one pattern, decoded once from the query steps.
+// args are the string arguments after the capture; #eq? may compare with a
+// second capture instead.
+struct PrpfmtPredicate {
+  PredicateKind kind;
+  bool negated;
+  uint32_t capture;
+  uint32_t other_capture;  // UINT32_MAX unless #eq? @a @b
+  const TSQueryPredicateStep *args;
+  uint32_t arg_count;
+  regex_t regex;
+};
+
+static bool name_is(const char *name, uint32_t length, const char *expected) {
+  return length == strlen(expected) && memcmp(name, expected, length) == 0;
+}
+
+// Decode the predicate in steps[0..count) into predicate. Directives
+// (#set!, ...) and unknown predicates return false and are ignored.
+static bool decode_predicate(const TSQuery *query, const TSQueryPredicateStep *steps, uint32_t count,
+                             PrpfmtPredicate *predicate) {
+  if (count < 2 || steps[0].type != TSQueryPredicateStepTypeString ||
+      steps[1].type != TSQueryPredicateStepTypeCapture) {
+    return false;
+  }
+  uint32_t length;
+  const char *name = ts_query_string_value_for_id(query, steps[0].value_id, &length);
+  predicate->negated = length > 4 && memcmp(name, "not-", 4) == 0;
+  if (predicate->negated) {
+    name += 4;
+    length -= 4;
+  }
+  if (name_is(name, length, "eq?")) {
+    predicate->kind = PREDICATE_EQ;
+  } else if (name_is(name, length, "any-of?")) {
+    predicate->kind = PREDICATE_ANY_OF;
+  } else if (name_is(name, length, "match?")) {
+    predicate->kind = PREDICATE_MATCH;
+  } else if (name_is(name, length, "contains?")) {
+    predicate->kind = PREDICATE_CONTAINS;
+  } else {
+    return false;
+  }
+
+  predicate->capture = steps[1].value_id;
+  predicate->other_capture = UINT32_MAX;
+  predicate->args = steps + 2;
+  predicate->arg_count = count - 2;
+  if (predicate->kind == PREDICATE_EQ && count == 3 && steps[2].type == TSQueryPredicateStepTypeCapture) {
+    predicate->other_capture = steps[2].value_id;
+    predicate->arg_count = 0;
+    return true;
+  }
+  for (uint32_t i = 0; i < predicate->arg_count; i++) {
+    if (predicate->args[i].type != TSQueryPredicateStepTypeString) {
+      return false;
+    }
+  }
+  if (predicate->kind == PREDICATE_MATCH) {
+    // Query regexes are written for Rust's regex crate; POSIX extended
+    // syntax covers what highlight queries use
+    const char *pattern = ts_query_string_value_for_id(query, predicate->args[0].value_id, &length);
+    if (predicate->arg_count != 1 || regcomp(&predicate->regex, pattern, REG_EXTENDED | REG_NOSUB) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool prpfmt_highlighter_init(PrpfmtHighlighter *hl) {
+  const TSQuery *query = prpfmt_query(PRPFMT_QUERY_HIGHLIGHTS);
+  if (!query) {
+    memset(hl, 0, sizeof(*hl));
+    return false;
+  }
+  return prpfmt_highlighter_init_query(hl, query);
+}
+
+bool prpfmt_highlighter_init_query(PrpfmtHighlighter *hl, const TSQuery *query) {
+  memset(hl, 0, sizeof(*hl));
+  hl->query = query;
+
+  uint32_t pattern_count = ts_query_pattern_count(hl->query);
+  uint32_t capacity = 0;
+  hl->pattern_predicates = malloc((pattern_count + 1) * sizeof(uint32_t));
+  hl->cursor = ts_query_cursor_new();
+  if (!hl->pattern_predicates || !hl->cursor) {
+    prpfmt_highlighter_destroy(hl);
+    return false;
+  }
+  hl->pattern_predicates[pattern_count] = 0;
+
+  uint32_t predicate_count = 0;
+  for (uint32_t p = 0; p < pattern_count; p++) {
+    hl->pattern_predicates[p] = predicate_count;
+    uint32_t step_count;
+    const TSQueryPredicateStep *steps = ts_query_predicates_for_pattern(hl->query, p, &step_count);
+    uint32_t start = 0;
+    for (uint32_t i = 0; i < step_count; i++) {
+      if (steps[i].type != TSQueryPredicateStepTypeDone) {
+        continue;
+      }
+      if (predicate_count == capacity) {
+        capacity = capacity ? capacity * 2 : 16;
+        PrpfmtPredicate *grown = realloc(hl->predicates, capacity * sizeof(PrpfmtPredicate));
+        if (!grown) {
+          hl->pattern_predicates[pattern_count] = predicate_count;
+          prpfmt_highlighter_destroy(hl);
+          return false;
+        }
+        hl->predicates = grown;
+      }
+      if (decode_predicate(hl->query, steps + start, i - start, &hl->predicates[predicate_count])) {
+        predicate_count++;
+      }
+      start = i + 1;
+    }
+  }
+  hl->pattern_predicates[pattern_count] = predicate_count;
+  return true;
+}
+
+static bool capture_text(const TSQueryMatch *match, uint32_t capture, const char *source, const char **text,
+                         uint32_t *length) {
+  for (uint16_t i = 0; i < match->capture_count; i++) {
+    if (match->captures[i].index == capture) {
+      uint32_t start = ts_node_start_byte(match->captures[i].node);
+      *text = source + start;
+      *length = ts_node_end_byte(match->captures[i].node) - start;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool contains(const char *text, uint32_t length, const char *needle, uint32_t needle_length) {
+  for (uint32_t i = 0; i + needle_length <= length; i++) {
+    if (memcmp(text + i, needle, needle_length) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool predicate_holds(const PrpfmtHighlighter *hl, const PrpfmtPredicate *predicate,
+                            const TSQueryMatch *match, const char *source) {
+  const char *text;
+  uint32_t length;
+  if (!capture_text(match, predicate->capture, source, &text, &length)) {
+    return true;
+  }
+
+  bool result = false;
+  if (predicate->other_capture != UINT32_MAX) {
+    const char *other;
+    uint32_t other_length;
+    result = capture_text(match, predicate->other_capture, source, &other, &other_length) &&
+             other_length == length && memcmp(text, other, length) == 0;
+  } else if (predicate->kind == PREDICATE_MATCH) {
+    char small[256];
+    char *copy = length < sizeof(small) ? small : malloc(length + 1);
+    if (copy) {
+      memcpy(copy, text, length);
+      copy[length] = '\0';
+      result = regexec(&predicate->regex, copy, 0, NULL, 0) == 0;
+      if (copy != small) {
+        free(copy);
+      }
+    }
+  } else {
+    for (uint32_t i = 0; i < predicate->arg_count && !result; i++) {
+      uint32_t value_length;
+      const char *value = ts_query_string_value_for_id(hl->query, predicate->args[i].value_id, &value_length);
+      if (predicate->kind == PREDICATE_CONTAINS) {
+        result = contains(text, length, value, value_length);
+      } else {
+        result = value_length == length && memcmp(text, value, length) == 0;
+      }
+      if (predicate->kind == PREDICATE_EQ) {
+        break;
+      }
+    }
+  }
+  return result != predicate->negated;
+}
+
+static bool match_holds(const PrpfmtHighlighter *hl, const TSQueryMatch *match, const char *source) {
+  uint32_t end = hl->pattern_predicates[match->pattern_index + 1];
+  for (uint32_t i = hl->pattern_predicates[match->pattern_index]; i < end; i++) {
+    if (!predicate_holds(hl, &hl->predicates[i], match, source)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static int compare_spans(const void *a, const void *b) {
+  const PrpfmtSpan *x = a;
+  const PrpfmtSpan *y = b;
+  if (x->start_byte != y->start_byte) {
+    return x->start_byte < y->start_byte ? -1 : 1;
+  }
+  if (x->end_byte != y->end_byte) {
+    return x->end_byte > y->end_byte ? -1 : 1;
+  }
+  return (int)x->pattern - (int)y->pattern;
+}
+
+bool prpfmt_highlight(PrpfmtHighlighter *hl, TSTree *tree, const char *source) {
+  hl->span_count = 0;
+  ts_query_cursor_exec(hl->cursor, hl->query, ts_tree_root_node(tree));
+
+  TSQueryMatch match;
+  uint32_t capture_index;
+  while (ts_query_cursor_next_capture(hl->cursor, &match, &capture_index)) {
+    if (!match_holds(hl, &match, source)) {
+      ts_query_cursor_remove_match(hl->cursor, match.id);
+      continue;
+    }
+
+    if (hl->span_count == hl->span_capacity) {
+      uint32_t capacity = hl->span_capacity ? hl->span_capacity * 2 : 1024;
+      PrpfmtSpan *spans = realloc(hl->spans, capacity * sizeof(PrpfmtSpan));
+      if (!spans) {
+        return false;
+      }
+      hl->spans = spans;
+      hl->span_capacity = capacity;
+    }
+    TSNode node = match.captures[capture_index].node;
+    hl->spans[hl->span_count++] = (PrpfmtSpan){
+      .start_byte = ts_node_start_byte(node),
+      .end_byte = ts_node_end_byte(node),
+      .capture = (uint16_t)match.captures[capture_index].index,
+      .pattern = match.pattern_index,
+    };
+  }
+
+  // Captures arrive in start order but not always outermost first; after
+  // sorting, spans over the same range are adjacent with the last pattern last
+  qsort(hl->spans, hl->span_count, sizeof(PrpfmtSpan), compare_spans);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < hl->span_count; i++) {
+    if (kept > 0 && hl->spans[kept - 1].start_byte == hl->spans[i].start_byte &&
+        hl->spans[kept - 1].end_byte == hl->spans[i].end_byte) {
+      kept--;
+    }
+    hl->spans[kept++] = hl->spans[i];
+  }
+  hl->capture_count = hl->span_count;
+  hl->span_count = kept;
+  return true;
+}
+
+void prpfmt_highlighter_destroy(PrpfmtHighlighter *hl) {
+  if (hl->pattern_predicates) {
+    uint32_t predicate_count = hl->pattern_predicates[ts_query_pattern_count(hl->query)];
+    for (uint32_t i = 0; i < predicate_count; i++) {
+      if (hl->predicates[i].kind == PREDICATE_MATCH) {
+        regfree(&hl->predicates[i].regex);
+      }
+    }
+  }
+  if (hl->cursor) {
+    ts_query_cursor_delete(hl->cursor);
+  }
+  free(hl->predicates);
+  free(hl->pattern_predicates);
+  free(hl->spans);
+  memset(hl, 0, sizeof(*hl));
+}
@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+
+#include "prpfmt.h"
+
+typedef struct {
+  uint32_t start;
+  uint32_t end;
+} ByteRange;
+
+typedef struct {
+  ByteRange *ranges;
+  uint32_t count;
+  uint32_t capacity;
+} RangeList;
+
+typedef struct {
+  PrpfmtTextEdit *edits;
+  uint32_t count;
+  uint32_t capacity;
+} TextEditList;
+
+static bool range_list_push(RangeList *list, uint32_t start, uint32_t end) {
+  if (list->count == list->capacity) {
+    uint32_t capacity = list->capacity ? list->capacity * 2 : 16;
+    ByteRange *ranges = realloc(list->ranges, capacity * sizeof(ByteRange));
+    if (!ranges) {
+      return false;
+    }
+    list->ranges = ranges;
+    list->capacity = capacity;
+  }
+  list->ranges[list->count++] = (ByteRange){start, end};
+  return true;
+}
+
+// Move a range recorded before `edit` into the coordinates after it
+static void range_apply_edit(ByteRange *range, const TSInputEdit *edit) {
+  int64_t delta = (int64_t)edit->new_end_byte - (int64_t)edit->old_end_byte;
+
+  if (range->start >= edit->old_end_byte) {
+    range->start = (uint32_t)(range->start + delta);
+  } else if (range->start > edit->start_byte) {
+    range->start = edit->start_byte;
+  }
+
+  if (range->end >= edit->old_end_byte) {
+    range->end = (uint32_t)(range->end + delta);
+  } else if (range->end > edit->start_byte) {
+    range->end = edit->new_end_byte;
+  }
+}
+
+static bool range_list_touches(const RangeList *list, uint32_t start, uint32_t end) {
+  for (uint32_t i = 0; i < list->count; i++) {
+    if (list->ranges[i].start <= end && start <= list->ranges[i].end) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool text_edit_push(TextEditList *list, TSNode node, const PrpfmtSink *formatted) {
+  if (list->count == list->capacity) {
+    uint32_t capacity = list->capacity ? list->capacity * 2 : 16;
+    PrpfmtTextEdit *edits = realloc(list->edits, capacity * sizeof(PrpfmtTextEdit));
+    if (!edits) {
+      return false;
+    }
+    list->edits = edits;
+    list->capacity = capacity;
+  }
+
+  char *text = malloc(formatted->length + 1);
+  if (!text) {
+    return false;
+  }
+  memcpy(text, formatted->buffer, formatted->length);
+  text[formatted->length] = '\0';
+
+  list->edits[list->count++] = (PrpfmtTextEdit){
+    .start_byte = ts_node_start_byte(node),
+    .end_byte = ts_node_end_byte(node),
+    .text = text,
+    .length = (uint32_t)formatted->length,
+  };
+  return true;
+}
+
+// Whether a comment node of tree overlaps [start, end]. Only subtrees that
+// overlap the range are entered.
+static bool range_has_comment(TSNode root, uint32_t start, uint32_t end) {
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+  bool found = false;
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    bool overlaps = ts_node_start_byte(node) <= end && start <= ts_node_end_byte(node);
+    if (overlaps && ts_node_grammar_symbol(node) == sym_comment) {
+      found = true;
+      break;
+    }
+    if (overlaps && ts_tree_cursor_goto_first_child(&cursor)) {
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        goto done;
+      }
+    }
+  }
+done:
+  ts_tree_cursor_delete(&cursor);
+  return found;
+}
+
+// Format one top-level statement into `formatted` and record an edit if the
+// result differs from the source. The statement text itself never ends with
+// the separating newline, so that is dropped from the formatted text too.
+static bool format_statement(TSNode node, PrpfmtState *st, PrpfmtSink *formatted, TextEditList *list) {
+  formatted->length = 0;
+  print_statement(node, st);
+  if (formatted->failed) {
+    return false;
+  }
+  if (formatted->length > 0 && formatted->buffer[formatted->length - 1] == '\n') {
+    formatted->length--;
+  }
+
+  uint32_t start_byte = ts_node_start_byte(node);
+  uint32_t length = ts_node_end_byte(node) - start_byte;
+  if (formatted->length == length && memcmp(formatted->buffer, st->source_code + start_byte, length) == 0) {
+    return true;
+  }
+  return text_edit_push(list, node, formatted);
+}
+
+TSTree *prpfmt_format_incremental(TSParser *parser, TSTree *old_tree,
+                                  const TSInputEdit *edits, uint32_t edit_count,
+                                  const char *source, uint32_t length,
+                                  PrpfmtTextEdit **text_edits, uint32_t *text_edit_count) {
+  *text_edits = NULL;
+  *text_edit_count = 0;
+
+  // Dirty byte ranges in the new source. Edits are applied in order, so
+  // earlier ranges are shifted by every later edit. An edit that touches a
+  // comment may add or remove a prpfmt on/off directive, which changes every
+  // statement after it; the old text is gone, so such an edit makes the whole
+  // source dirty.
+  RangeList dirty = {0};
+  bool ok = true;
+  bool all_dirty = !old_tree;
+  if (old_tree) {
+    for (uint32_t i = 0; i < edit_count; i++) {
+      all_dirty = all_dirty ||
+                  range_has_comment(ts_tree_root_node(old_tree), edits[i].start_byte, edits[i].old_end_byte);
+      ts_tree_edit(old_tree, &edits[i]);
+      for (uint32_t j = 0; j < dirty.count; j++) {
+        range_apply_edit(&dirty.ranges[j], &edits[i]);
+      }
+      ok = ok && range_list_push(&dirty, edits[i].start_byte, edits[i].new_end_byte);
+    }
+  }
+
+  TSTree *tree = ts_parser_parse_string(parser, old_tree, source, length);
+  if (!tree) {
+    free(dirty.ranges);
+    return NULL;
+  }
+
+  if (old_tree) {
+    uint32_t changed_count = 0;
+    TSRange *changed = ts_tree_get_changed_ranges(old_tree, tree, &changed_count);
+    for (uint32_t i = 0; i < changed_count; i++) {
+      ok = ok && range_list_push(&dirty, changed[i].start_byte, changed[i].end_byte);
+    }
+    free(changed);
+  }
+
+  // prpfmt on/off directives at any depth, as full and range formatting
+  // read them. A directive inside a dirty range may be new.
+  PrpfmtDirectiveIndex directives;
+  ok = ok && prpfmt_directives_build(tree, source, &directives);
+  if (!ok) {
+    free(dirty.ranges);
+    ts_tree_delete(tree);
+    return NULL;
+  }
+  for (uint32_t i = 0; i < directives.count && !all_dirty; i++) {
+    all_dirty = range_list_touches(&dirty, directives.directives[i].end_byte, directives.directives[i].end_byte);
+  }
+  if (all_dirty) {
+    dirty.count = 0;
+    ok = range_list_push(&dirty, 0, length);
+  }
+
+  PrpfmtSink formatted;
+  prpfmt_sink_init_memory(&formatted);
+  PrpfmtState state = {
+    .source_code = source,
+    .out = &formatted,
+    .indent_level = 0,
+    .indent_size = 2,
+    .fmt_on = true
+  };
+
+  // Walk the top-level statements in order. Each dirty statement starts with
+  // the directive state at its first byte, so a skipped statement never
+  // needs to be printed to know whether its successors are formatted.
+  TextEditList list = {0};
+  TSNode root_node = ts_tree_root_node(tree);
+  state.cursor = ts_tree_cursor_new(root_node);
+  state.lookahead = ts_tree_cursor_new(root_node);
+
+  for (TSNode child = cursor_first_child(&state); ok && !ts_node_is_null(child); child = cursor_next_sibling(&state)) {
+    if (ts_node_grammar_symbol(child) == sym_comment || ts_node_has_error(child) ||
+        !range_list_touches(&dirty, ts_node_start_byte(child), ts_node_end_byte(child))) {
+      continue;
+    }
+    state.fmt_on = prpfmt_directives_fmt_on(&directives, ts_node_start_byte(child));
+    if (state.fmt_on) {
+      ok = format_statement(child, &state, &formatted, &list);
+    }
+  }
+
+  ts_tree_cursor_delete(&state.lookahead);
+  ts_tree_cursor_delete(&state.cursor);
+  prpfmt_sink_destroy(&formatted);
+  prpfmt_directives_free(&directives);
+  free(dirty.ranges);
+
+  if (!ok) {
+    prpfmt_text_edits_free(list.edits, list.count);
+    ts_tree_delete(tree);
+    return NULL;
+  }
+
+  *text_edits = list.edits;
+  *text_edit_count = list.count;
+  return tree;
+}
+
+void prpfmt_text_edits_free(PrpfmtTextEdit *text_edits, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    free(text_edits[i].text);
+  }
+  free(text_edits);
+}
@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+// Read everything from fd into a growing heap buffer
+static int read_stream(PrpfmtInput *input, int fd) {
+  size_t capacity = PRPFMT_SINK_BLOCK_SIZE;
+  size_t length = 0;
+  char *buffer = malloc(capacity);
+  if (!buffer) {
+    return ENOMEM;
+  }
+
+  for (;;) {
+    if (length == capacity) {
+      if (capacity > UINT32_MAX) {
+        free(buffer);
+        return EFBIG;
+      }
+      char *grown = realloc(buffer, capacity * 2);
+      if (!grown) {
+        free(buffer);
+        return ENOMEM;
+      }
+      buffer = grown;
+      capacity *= 2;
+    }
+    ssize_t count = read(fd, buffer + length, capacity - length);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      int error = errno;
+      free(buffer);
+      return error;
+    }
+    if (count == 0) {
+      break;
+    }
+    length += (size_t)count;
+  }
+
+  if (length > UINT32_MAX) {
+    free(buffer);
+    return EFBIG;
+  }
+  input->owned = buffer;
+  input->data = buffer;
+  input->length = (uint32_t)length;
+  return 0;
+}
+
+// Open path and expose its bytes. Returns 0 or an errno value.
+int prpfmt_input_open(PrpfmtInput *input, const char *path) {
+  memset(input, 0, sizeof(*input));
+  input->data = "";
+
+  if (strcmp(path, "-") == 0) {
+    return read_stream(input, STDIN_FILENO);
+  }
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return errno;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0) {
+    int error = errno;
+    close(fd);
+    return error;
+  }
+
+  int error = 0;
+  if (!S_ISREG(sb.st_mode)) {
+    error = read_stream(input, fd);
+  } else if ((uintmax_t)sb.st_size > UINT32_MAX) {
+    error = EFBIG;
+  } else if (sb.st_size > 0) {
+    void *map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      // Some filesystems cannot be mapped; read them instead
+      error = read_stream(input, fd);
+    } else {
+      posix_madvise(map, (size_t)sb.st_size, POSIX_MADV_SEQUENTIAL);
+      input->data = map;
+      input->length = (uint32_t)sb.st_size;
+      input->mapped_size = (size_t)sb.st_size;
+    }
+  }
+
+  close(fd);
+  return error;
+}
+
+void prpfmt_input_close(PrpfmtInput *input) {
+  if (input->mapped_size) {
+    munmap((void *)input->data, input->mapped_size);
+  }
+  free(input->owned);
+  memset(input, 0, sizeof(*input));
+}
@@ -0,0 +1,70 @@
+#include <pthread.h>
+
+#include "prpfmt.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+// Generated from queries/*.scm by embed_queries.cmake, in PrpfmtQueryKind order
+extern const char *const prpfmt_query_sources[PRPFMT_QUERY_COUNT];
+extern const uint32_t prpfmt_query_lengths[PRPFMT_QUERY_COUNT];
+
+typedef struct {
+  const char *name;
+  TSQuery *query;
+  uint32_t error_offset;
+  TSQueryError error;
+} QueryEntry;
+
+static QueryEntry registry[PRPFMT_QUERY_COUNT] = {
+  [PRPFMT_QUERY_HIGHLIGHTS] = {.name = "highlights"},
+  [PRPFMT_QUERY_FOLDS] = {.name = "folds"},
+  [PRPFMT_QUERY_INDENTS] = {.name = "indents"},
+};
+
+static void compile_query(PrpfmtQueryKind kind) {
+  QueryEntry *entry = &registry[kind];
+  entry->query = ts_query_new(tree_sitter_pyrope(), prpfmt_query_sources[kind], prpfmt_query_lengths[kind],
+                              &entry->error_offset, &entry->error);
+}
+
+// pthread_once takes no argument, so each query has its own init function
+static void compile_highlights(void) { compile_query(PRPFMT_QUERY_HIGHLIGHTS); }
+static void compile_folds(void) { compile_query(PRPFMT_QUERY_FOLDS); }
+static void compile_indents(void) { compile_query(PRPFMT_QUERY_INDENTS); }
+
+static pthread_once_t compiled[PRPFMT_QUERY_COUNT] = {PTHREAD_ONCE_INIT, PTHREAD_ONCE_INIT, PTHREAD_ONCE_INIT};
+static void (*const compile_fns[PRPFMT_QUERY_COUNT])(void) = {
+  [PRPFMT_QUERY_HIGHLIGHTS] = compile_highlights,
+  [PRPFMT_QUERY_FOLDS] = compile_folds,
+  [PRPFMT_QUERY_INDENTS] = compile_indents,
+};
+
+const TSQuery *prpfmt_query(PrpfmtQueryKind kind) {
+  if (kind >= PRPFMT_QUERY_COUNT) {
+    return NULL;
+  }
+  pthread_once(&compiled[kind], compile_fns[kind]);
+  return registry[kind].query;
+}
+
+TSQueryError prpfmt_query_error(PrpfmtQueryKind kind, uint32_t *offset) {
+  if (!prpfmt_query(kind) && kind < PRPFMT_QUERY_COUNT) {
+    *offset = registry[kind].error_offset;
+    return registry[kind].error;
+  }
+  *offset = 0;
+  return TSQueryErrorNone;
+}
+
+const char *prpfmt_query_name(PrpfmtQueryKind kind) {
+  return kind < PRPFMT_QUERY_COUNT ? registry[kind].name : NULL;
+}
+
+const char *prpfmt_query_source(PrpfmtQueryKind kind, uint32_t *length) {
+  if (kind >= PRPFMT_QUERY_COUNT) {
+    *length = 0;
+    return NULL;
+  }
+  *length = prpfmt_query_lengths[kind];
+  return prpfmt_query_sources[kind];
+}
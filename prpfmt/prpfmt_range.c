@@ -0,0 +1,250 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+
+#include "prpfmt.h"
+
+// Innermost statement containing node, or a null node
+static TSNode enclosing_statement(TSNode node) {
+  while (!ts_node_is_null(node) && ts_node_grammar_symbol(node) != sym_statement) {
+    node = ts_node_parent(node);
+  }
+  return node;
+}
+
+static TSNode statement_at(TSNode root, uint32_t byte) {
+  return enclosing_statement(ts_node_descendant_for_byte_range(root, byte, byte));
+}
+
+// Climb first and last to the nearest pair of statements that share a parent
+static bool sibling_statements(TSNode *first, TSNode *last) {
+  for (TSNode f = *first; !ts_node_is_null(f); f = enclosing_statement(ts_node_parent(f))) {
+    TSNode parent = ts_node_parent(f);
+    for (TSNode l = *last; !ts_node_is_null(l); l = enclosing_statement(ts_node_parent(l))) {
+      if (ts_node_eq(ts_node_parent(l), parent)) {
+        *first = f;
+        *last = l;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Indent printed in front of node: one level per enclosing scope or match body
+static int inherited_indent_level(TSNode node) {
+  int level = 0;
+  for (TSNode n = ts_node_parent(node); !ts_node_is_null(n); n = ts_node_parent(n)) {
+    TSSymbol symbol = ts_node_grammar_symbol(n);
+    if (symbol == sym_scope_statement || symbol == sym_match_expression) {
+      level++;
+    }
+  }
+  return level;
+}
+
+bool prpfmt_directives_build(TSTree *tree, const char *source, PrpfmtDirectiveIndex *index) {
+  index->directives = NULL;
+  index->count = 0;
+  uint32_t capacity = 0;
+
+  // Comments are extras and may sit anywhere in the tree, so every node is
+  // visited; check_format_directives decides what a comment switches to.
+  PrpfmtState state = {.source_code = source};
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  bool ok = true;
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    if (ts_node_grammar_symbol(node) == sym_comment) {
+      state.fmt_on = true;
+      check_format_directives(node, &state);
+      bool off = !state.fmt_on;
+      state.fmt_on = false;
+      check_format_directives(node, &state);
+      bool on = state.fmt_on;
+      if (off || on) {
+        if (index->count == capacity) {
+          capacity = capacity ? capacity * 2 : 8;
+          PrpfmtDirective *grown = realloc(index->directives, capacity * sizeof(PrpfmtDirective));
+          if (!grown) {
+            ok = false;
+            break;
+          }
+          index->directives = grown;
+        }
+        index->directives[index->count++] = (PrpfmtDirective){ts_node_end_byte(node), !off};
+      }
+    }
+
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        break;
+      }
+    }
+    if (ts_tree_cursor_current_depth(&cursor) == 0) {
+      break;
+    }
+  }
+  ts_tree_cursor_delete(&cursor);
+
+  if (!ok) {
+    prpfmt_directives_free(index);
+  }
+  return ok;
+}
+
+// The last directive that ends at or before offset decides whether
+// formatting is on there
+bool prpfmt_directives_fmt_on(const PrpfmtDirectiveIndex *index, uint32_t offset) {
+  uint32_t low = 0;
+  uint32_t high = index->count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (index->directives[mid].end_byte <= offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low == 0 || index->directives[low - 1].fmt_on;
+}
+
+void prpfmt_directives_free(PrpfmtDirectiveIndex *index) {
+  free(index->directives);
+  index->directives = NULL;
+  index->count = 0;
+}
+
+bool prpfmt_format_range(TSTree *tree, const char *source, const PrpfmtDirectiveIndex *directives,
+                         uint32_t start_byte, uint32_t end_byte, PrpfmtTextEdit *text_edit) {
+  memset(text_edit, 0, sizeof(*text_edit));
+
+  // Trim blank space so a selection of whole lines starts and ends in code
+  while (start_byte < end_byte && isspace((unsigned char)source[start_byte])) {
+    start_byte++;
+  }
+  while (end_byte > start_byte && isspace((unsigned char)source[end_byte - 1])) {
+    end_byte--;
+  }
+  if (start_byte == end_byte) {
+    return false;
+  }
+
+  TSNode root_node = ts_tree_root_node(tree);
+  TSNode first = statement_at(root_node, start_byte);
+  TSNode last = statement_at(root_node, end_byte - 1);
+  if (ts_node_is_null(first) || ts_node_is_null(last) || !sibling_statements(&first, &last)) {
+    return false;
+  }
+
+  PrpfmtSink formatted;
+  prpfmt_sink_init_memory(&formatted);
+  PrpfmtState state = {
+    .source_code = source,
+    .out = &formatted,
+    .indent_level = inherited_indent_level(first),
+    .indent_size = 2,
+    .fmt_on = prpfmt_directives_fmt_on(directives, ts_node_start_byte(first)),
+    .prev_sibling = ts_node_prev_sibling(first)
+  };
+
+  // Walk the siblings first..last with the shared cursor, rooted at their parent
+  TSNode parent = ts_node_parent(first);
+  state.cursor = ts_tree_cursor_new(parent);
+  state.lookahead = ts_tree_cursor_new(parent);
+  ts_tree_cursor_goto_first_child_for_byte(&state.cursor, ts_node_start_byte(first));
+
+  bool ok = true;
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&state.cursor);
+    if (ts_node_has_error(node)) {
+      ok = false;
+      break;
+    }
+    print_statement(node, &state);
+    if (ts_node_eq(node, last)) {
+      break;
+    }
+    state.prev_sibling = node;
+    if (!ts_tree_cursor_goto_next_sibling(&state.cursor)) {
+      break;
+    }
+  }
+
+  ts_tree_cursor_delete(&state.lookahead);
+  ts_tree_cursor_delete(&state.cursor);
+
+  if (!ok || formatted.failed) {
+    prpfmt_sink_destroy(&formatted);
+    return false;
+  }
+
+  // Replace from the start of the first line when only indentation precedes
+  // the first statement; otherwise keep the existing prefix and drop ours.
+  uint32_t edit_start = ts_node_start_byte(first);
+  while (edit_start > 0 && (source[edit_start - 1] == ' ' || source[edit_start - 1] == '\t')) {
+    edit_start--;
+  }
+  size_t skip = 0;
+  if (edit_start > 0 && source[edit_start - 1] != '\n') {
+    edit_start = ts_node_start_byte(first);
+    while (skip < formatted.length && formatted.buffer[skip] == ' ') {
+      skip++;
+    }
+  }
+
+  size_t length = formatted.length - skip;
+  if (length > 0 && formatted.buffer[skip + length - 1] == '\n') {
+    length--;
+  }
+
+  text_edit->text = malloc(length + 1);
+  if (!text_edit->text) {
+    prpfmt_sink_destroy(&formatted);
+    return false;
+  }
+  memcpy(text_edit->text, formatted.buffer + skip, length);
+  text_edit->text[length] = '\0';
+  text_edit->length = (uint32_t)length;
+  text_edit->start_byte = edit_start;
+  text_edit->end_byte = ts_node_end_byte(last);
+
+  prpfmt_sink_destroy(&formatted);
+  return true;
+}
+
+// Byte range covering 1-based lines first_line..last_line, inclusive
+bool prpfmt_line_range(const char *source, uint32_t length, uint32_t first_line, uint32_t last_line,
+                       uint32_t *start_byte, uint32_t *end_byte) {
+  if (first_line == 0 || last_line < first_line) {
+    return false;
+  }
+
+  uint32_t line = 1;
+  uint32_t offset = 0;
+  while (line < first_line) {
+    const char *newline = memchr(source + offset, '\n', length - offset);
+    if (!newline) {
+      return false;
+    }
+    offset = (uint32_t)(newline - source) + 1;
+    line++;
+  }
+  *start_byte = offset;
+
+  while (line <= last_line) {
+    const char *newline = memchr(source + offset, '\n', length - offset);
+    if (!newline) {
+      offset = length;
+      break;
+    }
+    offset = (uint32_t)(newline - source) + 1;
+    line++;
+  }
+  *end_byte = offset;
+  return true;
+}
@@ -0,0 +1,115 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+static void sink_init(PrpfmtSink *sink, PrpfmtSinkKind kind, size_t capacity) {
+  memset(sink, 0, sizeof(*sink));
+  sink->kind = kind;
+  sink->fd = -1;
+  sink->buffer = malloc(capacity);
+  if (!sink->buffer) {
+    perror("Failed to allocate output buffer");
+    sink->failed = true;
+    return;
+  }
+  sink->capacity = capacity;
+}
+
+void prpfmt_sink_init_memory(PrpfmtSink *sink) {
+  sink_init(sink, PRPFMT_SINK_MEMORY, PRPFMT_SINK_BLOCK_SIZE);
+}
+
+void prpfmt_sink_init_fd(PrpfmtSink *sink, int fd) {
+  sink_init(sink, PRPFMT_SINK_FD, PRPFMT_SINK_BLOCK_SIZE);
+  sink->fd = fd;
+}
+
+void prpfmt_sink_init_callback(PrpfmtSink *sink, PrpfmtWriteFn write_fn, void *payload) {
+  sink_init(sink, PRPFMT_SINK_CALLBACK, PRPFMT_SINK_BLOCK_SIZE);
+  sink->write_fn = write_fn;
+  sink->payload = payload;
+}
+
+static bool write_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("Error writing output");
+      return false;
+    }
+    data += written;
+    length -= (size_t)written;
+  }
+  return true;
+}
+
+// Hand `length` bytes to the backing store of an fd or callback sink
+static void sink_emit(PrpfmtSink *sink, const char *data, size_t length) {
+  if (sink->failed || length == 0) {
+    return;
+  }
+  if (sink->kind == PRPFMT_SINK_FD) {
+    if (!write_all(sink->fd, data, length)) {
+      sink->failed = true;
+    }
+  } else if (sink->kind == PRPFMT_SINK_CALLBACK) {
+    sink->write_fn(sink->payload, data, length);
+  }
+}
+
+bool prpfmt_sink_flush(PrpfmtSink *sink) {
+  if (sink->kind != PRPFMT_SINK_MEMORY) {
+    sink_emit(sink, sink->buffer, sink->length);
+    sink->length = 0;
+  }
+  return !sink->failed;
+}
+
+void prpfmt_sink_write_slow(PrpfmtSink *sink, const char *data, size_t length) {
+  if (sink->failed) {
+    return;
+  }
+
+  if (sink->kind == PRPFMT_SINK_MEMORY) {
+    size_t capacity = sink->capacity ? sink->capacity : PRPFMT_SINK_BLOCK_SIZE;
+    while (capacity - sink->length < length) {
+      capacity *= 2;
+    }
+    char *buffer = realloc(sink->buffer, capacity);
+    if (!buffer) {
+      perror("Failed to grow output buffer");
+      sink->failed = true;
+      return;
+    }
+    sink->buffer = buffer;
+    sink->capacity = capacity;
+    memcpy(sink->buffer + sink->length, data, length);
+    sink->length += length;
+    return;
+  }
+
+  prpfmt_sink_flush(sink);
+  if (length >= sink->capacity) {
+    // Large writes bypass the staging buffer
+    sink_emit(sink, data, length);
+  } else {
+    memcpy(sink->buffer, data, length);
+    sink->length = length;
+  }
+}
+
+bool prpfmt_sink_destroy(PrpfmtSink *sink) {
+  bool ok = prpfmt_sink_flush(sink);
+  free(sink->buffer);
+  sink->buffer = NULL;
+  sink->length = 0;
+  sink->capacity = 0;
+  return ok;
+}
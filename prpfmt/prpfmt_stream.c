@@ -0,0 +1,328 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+// Bytes requested from the input per read, and handed to the parser per
+// TSInput callback
+#define STREAM_CHUNK_SIZE (1 << 16)
+
+typedef enum {
+  SCAN_CODE,
+  SCAN_LINE_COMMENT,
+  SCAN_BLOCK_COMMENT,
+  SCAN_SIMPLE_STRING,
+  SCAN_COMPLEX_STRING,
+} ScanMode;
+
+// The unformatted tail of the input. Everything before `cut` is a run of
+// complete top-level statements that can be parsed on its own.
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+  size_t parse_length;
+
+  // Boundary scanner state, carried across reads
+  size_t scan;
+  ScanMode mode;
+  int depth;
+  bool escape;
+  char prev_significant;
+  size_t pending;
+  size_t cut;
+  size_t retry_length;
+} StreamWindow;
+
+// Characters that, ending a line, leave an expression unfinished
+static bool ends_unfinished(char c) {
+  return c != '\0' && strchr(",=.><&^|*/+-!:~", c) != NULL;
+}
+
+// Mirrors the external scanner: no automatic semicolon is inserted before a
+// line starting with one of these, so the statement continues there.
+// Returns -1 when more input is needed to decide.
+static int continues_statement(const StreamWindow *w, size_t pos, bool eof) {
+  const char *p = w->data + pos;
+  size_t available = w->length - pos;
+
+  if (strchr(",=.><&^|*/+-", *p)) {
+    return 1;
+  }
+  if (*p == 'e') {
+    if (available < 4 && !eof) {
+      return -1;
+    }
+    return available >= 4 && (memcmp(p, "else", 4) == 0 || memcmp(p, "elif", 4) == 0);
+  }
+  if (*p == '!') {
+    if (available < 2 && !eof) {
+      return -1;
+    }
+    return available >= 2 && p[1] == '=';
+  }
+  return 0;
+}
+
+// Advance the boundary scanner over newly read bytes. A newline is a
+// candidate cut when it ends a top-level line that is not left unfinished;
+// it is confirmed once the next code character does not continue the line.
+static void scan_boundaries(StreamWindow *w, bool eof) {
+  while (w->scan < w->length) {
+    char c = w->data[w->scan];
+    bool has_next = w->scan + 1 < w->length;
+    char next = has_next ? w->data[w->scan + 1] : '\0';
+
+    switch (w->mode) {
+      case SCAN_LINE_COMMENT:
+        if (c == '\n') {
+          w->mode = SCAN_CODE;
+          continue;
+        }
+        w->scan++;
+        continue;
+      case SCAN_BLOCK_COMMENT:
+        if (c == '*' && !has_next && !eof) {
+          return;
+        }
+        if (c == '*' && next == '/') {
+          w->mode = SCAN_CODE;
+          w->scan += 2;
+        } else {
+          w->scan++;
+        }
+        continue;
+      case SCAN_SIMPLE_STRING:
+        if (c == '\'' || c == '\n') {
+          w->mode = SCAN_CODE;
+        }
+        w->scan++;
+        continue;
+      case SCAN_COMPLEX_STRING:
+        if (w->escape) {
+          w->escape = false;
+        } else if (c == '\\') {
+          w->escape = true;
+        } else if (c == '"' || c == '\n') {
+          w->mode = SCAN_CODE;
+        }
+        w->scan++;
+        continue;
+      case SCAN_CODE:
+        break;
+    }
+
+    if (c == '\n') {
+      if (w->depth == 0 && w->prev_significant && !ends_unfinished(w->prev_significant)) {
+        w->pending = w->scan + 1;
+      }
+      w->scan++;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\r') {
+      w->scan++;
+      continue;
+    }
+    if (c == '/') {
+      if (!has_next && !eof) {
+        return;
+      }
+      if (next == '/' || next == '*') {
+        w->mode = next == '/' ? SCAN_LINE_COMMENT : SCAN_BLOCK_COMMENT;
+        w->scan += 2;
+        continue;
+      }
+    }
+
+    if (w->pending) {
+      int continues = continues_statement(w, w->scan, eof);
+      if (continues < 0) {
+        return;
+      }
+      if (!continues) {
+        w->cut = w->pending;
+      }
+      w->pending = 0;
+    }
+
+    switch (c) {
+      case '(':
+      case '[':
+      case '{':
+        w->depth++;
+        break;
+      case ')':
+      case ']':
+      case '}':
+        // A stray closer is a parse error the window reports; clamping keeps
+        // it from disabling every later cut
+        if (w->depth > 0) {
+          w->depth--;
+        }
+        break;
+      case '\'':
+        w->mode = SCAN_SIMPLE_STRING;
+        break;
+      case '"':
+        w->mode = SCAN_COMPLEX_STRING;
+        break;
+    }
+    w->prev_significant = c;
+    w->scan++;
+  }
+}
+
+static const char *window_read(void *payload, uint32_t byte_index, TSPoint position, uint32_t *bytes_read) {
+  (void)position;
+  const StreamWindow *w = payload;
+  if (byte_index >= w->parse_length) {
+    *bytes_read = 0;
+    return "";
+  }
+  size_t remaining = w->parse_length - byte_index;
+  *bytes_read = remaining < STREAM_CHUNK_SIZE ? (uint32_t)remaining : STREAM_CHUNK_SIZE;
+  return w->data + byte_index;
+}
+
+// Parse the first `length` bytes of the window. Returns NULL if they do not
+// form error-free statements or the budget ran out (*parse_status says which).
+// The budget starts here: a slow producer must not use up the parse time.
+static TSTree *parse_window(TSParser *parser, StreamWindow *w, size_t length, PrpfmtParseBudget *budget,
+                            PrpfmtParseStatus *parse_status) {
+  w->parse_length = length;
+  if (budget) {
+    prpfmt_budget_start(budget);
+  }
+  TSInput input = {
+    .payload = w,
+    .read = window_read,
+    .encoding = TSInputEncodingUTF8,
+  };
+  TSTree *tree = prpfmt_parse(parser, NULL, input, budget, parse_status);
+  if (tree && ts_node_has_error(ts_tree_root_node(tree))) {
+    ts_tree_delete(tree);
+    return NULL;
+  }
+  return tree;
+}
+
+// Format a parsed window and hand it to out. Windows end on a line break, so
+// a window whose last line ends in an inline comment still gets its newline.
+static bool emit_window(TSTree *tree, StreamWindow *w, PrpfmtState *st, PrpfmtSink *formatted, bool last) {
+  formatted->length = 0;
+  st->source_code = w->data;
+  st->out = formatted;
+  print_tree(tree, st);
+  if (!last && formatted->length > 0 && formatted->buffer[formatted->length - 1] != '\n') {
+    prpfmt_sink_write(formatted, "\n", 1);
+  }
+  return !formatted->failed;
+}
+
+// Drop the first `length` bytes of the window
+static void window_consume(StreamWindow *w, size_t length) {
+  memmove(w->data, w->data + length, w->length - length);
+  w->length -= length;
+  w->scan -= length;
+  w->pending = w->pending > length ? w->pending - length : 0;
+  w->cut = 0;
+  w->retry_length = 0;
+}
+
+static bool window_reserve(StreamWindow *w, size_t extra) {
+  if (w->capacity - w->length >= extra) {
+    return true;
+  }
+  size_t capacity = w->capacity ? w->capacity : 4 * STREAM_CHUNK_SIZE;
+  while (capacity - w->length < extra) {
+    capacity *= 2;
+  }
+  char *data = realloc(w->data, capacity);
+  if (!data) {
+    return false;
+  }
+  w->data = data;
+  w->capacity = capacity;
+  return true;
+}
+
+static PrpfmtStreamStatus abort_status(PrpfmtParseStatus parse_status) {
+  return parse_status == PRPFMT_PARSE_TIMED_OUT ? PRPFMT_STREAM_TIMED_OUT : PRPFMT_STREAM_CANCELLED;
+}
+
+PrpfmtStreamStatus prpfmt_format_stream(TSParser *parser, int fd, PrpfmtSink *out, PrpfmtParseBudget *budget) {
+  StreamWindow w = {0};
+  PrpfmtSink formatted;
+  prpfmt_sink_init_memory(&formatted);
+  PrpfmtState state = {
+    .indent_level = 0,
+    .indent_size = 2,
+    .fmt_on = true
+  };
+
+  PrpfmtStreamStatus status = PRPFMT_STREAM_OK;
+  bool eof = false;
+  while (!eof && status == PRPFMT_STREAM_OK) {
+    if (!window_reserve(&w, STREAM_CHUNK_SIZE) || w.length + STREAM_CHUNK_SIZE > UINT32_MAX) {
+      status = PRPFMT_STREAM_READ_ERROR;
+      break;
+    }
+    ssize_t count = read(fd, w.data + w.length, STREAM_CHUNK_SIZE);
+    if (count < 0) {
+      if (errno != EINTR) {
+        status = PRPFMT_STREAM_READ_ERROR;
+      }
+      continue;
+    }
+    eof = count == 0;
+    w.length += (size_t)count;
+    scan_boundaries(&w, eof);
+
+    // Emit everything up to the last confirmed cut. A cut the parser rejects
+    // (e.g. a line ending in a keyword) is retried once the window doubles.
+    if (!eof && w.cut > 0 && w.cut >= w.retry_length) {
+      PrpfmtParseStatus parse_status;
+      TSTree *tree = parse_window(parser, &w, w.cut, budget, &parse_status);
+      if (parse_status != PRPFMT_PARSE_OK) {
+        status = abort_status(parse_status);
+        break;
+      }
+      if (!tree) {
+        w.retry_length = 2 * w.cut;
+        continue;
+      }
+      bool ok = emit_window(tree, &w, &state, &formatted, false);
+      ts_tree_delete(tree);
+      prpfmt_sink_write(out, formatted.buffer, formatted.length);
+      if (!ok || !prpfmt_sink_flush(out)) {
+        status = PRPFMT_STREAM_WRITE_ERROR;
+        break;
+      }
+      window_consume(&w, w.cut);
+    }
+  }
+
+  if (status == PRPFMT_STREAM_OK) {
+    PrpfmtParseStatus parse_status;
+    TSTree *tree = parse_window(parser, &w, w.length, budget, &parse_status);
+    if (parse_status != PRPFMT_PARSE_OK) {
+      status = abort_status(parse_status);
+    } else if (!tree) {
+      status = PRPFMT_STREAM_PARSE_ERROR;
+    } else {
+      bool ok = emit_window(tree, &w, &state, &formatted, true);
+      ts_tree_delete(tree);
+      prpfmt_sink_write(out, formatted.buffer, formatted.length);
+      if (!ok || !prpfmt_sink_flush(out)) {
+        status = PRPFMT_STREAM_WRITE_ERROR;
+      }
+    }
+  }
+
+  prpfmt_sink_destroy(&formatted);
+  free(w.data);
+  return status;
+}
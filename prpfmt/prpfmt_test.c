@@ -0,0 +1,465 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+// Library checks run by test.sh on the sample corpus:
+//
+//   incremental  Edits are applied one at a time to the formatted text of
+//                each file and re-formatted with prpfmt_format_incremental.
+//                After every edit the spliced result must equal a full
+//                reformat of the edited text, and re-running the incremental
+//                formatter on that result must change nothing. The same
+//                check runs on NESTED_DIRECTIVE, where a prpfmt off inside
+//                a block turns formatting off for the statements after it.
+//
+//   flat         prpfmt_flat_build must list the nodes of a cursor walk in
+//                pre-order with consistent links, and prpfmt_flat_write
+//                followed by prpfmt_flat_read must give back the same arrays.
+//
+//   budget       A parse of the file (repeated to BUDGET_MIN_BYTES, so the
+//                runtime checks the budget many times) must stop with
+//                PRPFMT_PARSE_CANCELLED under a cancel flag that is already
+//                set, and with PRPFMT_PARSE_TIMED_OUT under a deadline that
+//                has already passed. After each abort the parser must give
+//                the same tree as a fresh parser. Nothing here depends on
+//                how fast the machine parses.
+
+#define EDIT_STEPS 8
+#define BUDGET_MIN_BYTES (1 << 16)
+
+// Nothing after the comment is formatted, though it is not a top-level
+// statement
+static const char NESTED_DIRECTIVE[] = "if c {\n"
+                                       "  // prpfmt off\n"
+                                       "  x   =   1\n"
+                                       "}\n"
+                                       "y   =   2\n"
+                                       "z   =   (3,4)\n";
+
+void print_help() {
+  printf("Usage: ./prpfmt_test <file>...\n");
+}
+
+typedef struct {
+  char *data;
+  uint32_t length;
+} Text;
+
+static Text text_copy(const char *data, uint32_t length) {
+  Text text = {malloc(length + 1), length};
+  if (!text.data) {
+    fprintf(stderr, "Memory allocation failed");
+    exit(1);
+  }
+  memcpy(text.data, data, length);
+  text.data[length] = '\0';
+  return text;
+}
+
+// Format source as prpfmt does. Returns false if it does not parse cleanly.
+static bool format_full(TSParser *parser, const char *source, uint32_t length, Text *formatted) {
+  TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+  if (!tree || ts_node_has_error(ts_tree_root_node(tree))) {
+    ts_tree_delete(tree);
+    return false;
+  }
+
+  PrpfmtSink sink;
+  prpfmt_sink_init_memory(&sink);
+  PrpfmtState state = {
+    .source_code = source,
+    .out = &sink,
+    .indent_level = 0,
+    .indent_size = 2,
+    .fmt_on = true
+  };
+  print_tree(tree, &state);
+  ts_tree_delete(tree);
+
+  bool ok = !sink.failed && sink.length <= UINT32_MAX;
+  if (ok) {
+    *formatted = text_copy(sink.buffer, (uint32_t)sink.length);
+  }
+  prpfmt_sink_destroy(&sink);
+  return ok;
+}
+
+static TSPoint point_at(const Text *text, uint32_t byte) {
+  TSPoint point = {0, 0};
+  for (uint32_t i = 0; i < byte; i++) {
+    if (text->data[i] == '\n') {
+      point.row++;
+      point.column = 0;
+    } else {
+      point.column++;
+    }
+  }
+  return point;
+}
+
+// Replace [start, end) of text with insert, filling in *edit for the tree
+static Text text_replace(const Text *text, uint32_t start, uint32_t end, const char *insert, uint32_t insert_length,
+                         TSInputEdit *edit) {
+  Text result = {malloc(text->length - (end - start) + insert_length + 1), text->length - (end - start) + insert_length};
+  if (!result.data) {
+    fprintf(stderr, "Memory allocation failed");
+    exit(1);
+  }
+  memcpy(result.data, text->data, start);
+  memcpy(result.data + start, insert, insert_length);
+  memcpy(result.data + start + insert_length, text->data + end, text->length - end);
+  result.data[result.length] = '\0';
+
+  edit->start_byte = start;
+  edit->old_end_byte = end;
+  edit->new_end_byte = start + insert_length;
+  edit->start_point = point_at(text, start);
+  edit->old_end_point = point_at(text, end);
+  edit->new_end_point = point_at(&result, start + insert_length);
+  return result;
+}
+
+// Pick the step-th edit: rename an identifier or pad the space before an
+// `=` or `,`. Both keep the text parseable and leave the formatter work to
+// do in the statement they touch.
+static bool pick_edit(TSTree *tree, unsigned step, uint32_t *start, uint32_t *end, const char **insert) {
+  uint32_t candidates = 0;
+  uint32_t chosen = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    uint32_t seen = 0;
+    TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+    for (;;) {
+      TSNode node = ts_tree_cursor_current_node(&cursor);
+      TSSymbol symbol = ts_node_grammar_symbol(node);
+      bool leaf = ts_node_child_count(node) == 0;
+      if (leaf && !ts_node_is_extra(node) &&
+          (symbol == sym_identifier || symbol == anon_sym_EQ || symbol == anon_sym_COMMA)) {
+        if (pass == 1 && seen == chosen) {
+          if (symbol == sym_identifier) {
+            *start = *end = ts_node_end_byte(node);
+            *insert = "_e";
+          } else {
+            *start = *end = ts_node_start_byte(node);
+            *insert = "  ";
+          }
+          ts_tree_cursor_delete(&cursor);
+          return true;
+        }
+        seen++;
+      }
+      if (!leaf && ts_tree_cursor_goto_first_child(&cursor)) {
+        continue;
+      }
+      while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+        if (!ts_tree_cursor_goto_parent(&cursor)) {
+          break;
+        }
+      }
+      if (ts_tree_cursor_current_depth(&cursor) == 0) {
+        break;
+      }
+    }
+    ts_tree_cursor_delete(&cursor);
+    candidates = seen;
+    if (candidates == 0) {
+      return false;
+    }
+    chosen = (step * 7919u + 13u) % candidates;
+  }
+  return false;
+}
+
+// Splice text edits (sorted, non-overlapping) into text. Each is also
+// recorded as an input edit, last first so that every offset is still valid
+// when ts_tree_edit applies them in order.
+static Text splice_edits(const Text *text, const PrpfmtTextEdit *edits, uint32_t count, TSInputEdit *input_edits) {
+  Text result = text_copy(text->data, text->length);
+  for (uint32_t i = count; i-- > 0;) {
+    Text next = text_replace(&result, edits[i].start_byte, edits[i].end_byte, edits[i].text, edits[i].length,
+                             &input_edits[count - 1 - i]);
+    free(result.data);
+    result = next;
+  }
+  return result;
+}
+
+static bool check_incremental(TSParser *parser, const char *path, const char *source, uint32_t length) {
+  Text text;
+  if (!format_full(parser, source, length, &text)) {
+    printf("  skipped %s: does not parse\n", path);
+    return true;
+  }
+  Text again;
+  if (!format_full(parser, text.data, text.length, &again)) {
+    printf("FAIL incremental %s: formatted text does not parse\n", path);
+    free(text.data);
+    return false;
+  }
+  bool idempotent = again.length == text.length && memcmp(again.data, text.data, text.length) == 0;
+  free(again.data);
+  if (!idempotent) {
+    printf("  skipped %s: formatting is not idempotent\n", path);
+    free(text.data);
+    return true;
+  }
+
+  TSTree *tree = ts_parser_parse_string(parser, NULL, text.data, text.length);
+  bool ok = tree != NULL;
+  for (unsigned step = 0; ok && step < EDIT_STEPS; step++) {
+    uint32_t start, end;
+    const char *insert;
+    if (!pick_edit(tree, step, &start, &end, &insert)) {
+      break;
+    }
+    TSInputEdit edit;
+    Text edited = text_replace(&text, start, end, insert, (uint32_t)strlen(insert), &edit);
+
+    PrpfmtTextEdit *text_edits;
+    uint32_t text_edit_count;
+    TSTree *edited_tree = prpfmt_format_incremental(parser, tree, &edit, 1, edited.data, edited.length,
+                                                    &text_edits, &text_edit_count);
+    ts_tree_delete(tree);
+    tree = edited_tree;
+    if (!tree) {
+      printf("FAIL incremental %s: step %u: prpfmt_format_incremental failed\n", path, step);
+      free(edited.data);
+      ok = false;
+      break;
+    }
+
+    TSInputEdit *splice = malloc((text_edit_count + 1) * sizeof(TSInputEdit));
+    Text spliced = splice_edits(&edited, text_edits, text_edit_count, splice);
+    prpfmt_text_edits_free(text_edits, text_edit_count);
+
+    Text expected;
+    if (!format_full(parser, edited.data, edited.length, &expected)) {
+      printf("FAIL incremental %s: step %u: the edited text does not parse\n", path, step);
+      ok = false;
+    } else {
+      if (expected.length != spliced.length || memcmp(expected.data, spliced.data, spliced.length) != 0) {
+        printf("FAIL incremental %s: step %u: result differs from a full reformat\n", path, step);
+        ok = false;
+      }
+      free(expected.data);
+    }
+
+    // Bring the tree up to the spliced text; nothing is left to format
+    if (ok) {
+      edited_tree = prpfmt_format_incremental(parser, tree, splice, text_edit_count, spliced.data, spliced.length,
+                                              &text_edits, &text_edit_count);
+      ts_tree_delete(tree);
+      tree = edited_tree;
+      if (!tree || text_edit_count != 0) {
+        printf("FAIL incremental %s: step %u: reformatting the result changed it again\n", path, step);
+        ok = false;
+      }
+      if (tree) {
+        prpfmt_text_edits_free(text_edits, text_edit_count);
+      }
+    }
+
+    free(splice);
+    free(edited.data);
+    free(text.data);
+    text = spliced;
+  }
+
+  ts_tree_delete(tree);
+  free(text.data);
+  return ok;
+}
+
+// Compare flat with a fresh cursor walk over tree
+static bool flat_matches_tree(TSTree *tree, const PrpfmtFlatTree *flat) {
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(tree));
+  uint32_t index = 0;
+  bool ok = true;
+  for (;;) {
+    TSNode node = ts_tree_cursor_current_node(&cursor);
+    if (index >= flat->node_count || flat->symbol[index] != ts_node_grammar_symbol(node) ||
+        flat->field[index] != ts_tree_cursor_current_field_id(&cursor) ||
+        flat->start_byte[index] != ts_node_start_byte(node) || flat->end_byte[index] != ts_node_end_byte(node)) {
+      ok = false;
+      break;
+    }
+    uint32_t first = flat->first_child[index];
+    if (ts_node_child_count(node) > 0 ? first != index + 1 || flat->parent[first] != index
+                                      : first != PRPFMT_FLAT_NONE) {
+      ok = false;
+      break;
+    }
+    index++;
+
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        goto done;
+      }
+    }
+  }
+done:
+  ts_tree_cursor_delete(&cursor);
+  return ok && index == flat->node_count;
+}
+
+static bool flat_equal(const PrpfmtFlatTree *a, const PrpfmtFlatTree *b) {
+  size_t n = a->node_count;
+  return a->node_count == b->node_count && memcmp(a->symbol, b->symbol, n * sizeof(TSSymbol)) == 0 &&
+         memcmp(a->field, b->field, n * sizeof(TSFieldId)) == 0 &&
+         memcmp(a->flags, b->flags, n * sizeof(uint16_t)) == 0 &&
+         memcmp(a->parent, b->parent, n * sizeof(uint32_t)) == 0 &&
+         memcmp(a->first_child, b->first_child, n * sizeof(uint32_t)) == 0 &&
+         memcmp(a->next_sibling, b->next_sibling, n * sizeof(uint32_t)) == 0 &&
+         memcmp(a->start_byte, b->start_byte, n * sizeof(uint32_t)) == 0 &&
+         memcmp(a->end_byte, b->end_byte, n * sizeof(uint32_t)) == 0;
+}
+
+static bool check_flat(TSParser *parser, const char *path, const char *source, uint32_t length) {
+  TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+  PrpfmtFlatTree flat;
+  if (!tree || !prpfmt_flat_build(tree, &flat)) {
+    printf("FAIL flat %s: prpfmt_flat_build failed\n", path);
+    ts_tree_delete(tree);
+    return false;
+  }
+  bool ok = flat_matches_tree(tree, &flat);
+  if (!ok) {
+    printf("FAIL flat %s: nodes differ from a cursor walk\n", path);
+  }
+  ts_tree_delete(tree);
+
+  char flat_path[256];
+  const char *tmp = getenv("TMPDIR");
+  snprintf(flat_path, sizeof(flat_path), "%s/prpfmt_test.%ld.flat", tmp ? tmp : "/tmp", (long)getpid());
+  PrpfmtFlatTree read;
+  if (ok && !prpfmt_flat_write(&flat, tree_sitter_pyrope(), flat_path)) {
+    printf("FAIL flat %s: prpfmt_flat_write failed\n", path);
+    ok = false;
+  } else if (ok && !prpfmt_flat_read(&read, tree_sitter_pyrope(), flat_path)) {
+    printf("FAIL flat %s: prpfmt_flat_read rejected the written file\n", path);
+    ok = false;
+  } else if (ok) {
+    if (!flat_equal(&flat, &read)) {
+      printf("FAIL flat %s: the file read back differs\n", path);
+      ok = false;
+    }
+    prpfmt_flat_free(&read);
+  }
+  unlink(flat_path);
+  prpfmt_flat_free(&flat);
+  return ok;
+}
+
+// Parse source with parser, unbounded, and compare the tree with one from a
+// fresh parser: an aborted parse must not leave state behind
+static bool parses_like_fresh(TSParser *parser, const char *source, uint32_t length) {
+  TSParser *fresh = ts_parser_new();
+  ts_parser_set_language(fresh, tree_sitter_pyrope());
+  TSTree *expected = ts_parser_parse_string(fresh, NULL, source, length);
+  TSTree *tree = ts_parser_parse_string(parser, NULL, source, length);
+  char *expected_text = ts_node_string(ts_tree_root_node(expected));
+  char *text = ts_node_string(ts_tree_root_node(tree));
+  bool same = strcmp(expected_text, text) == 0;
+  free(expected_text);
+  free(text);
+  ts_tree_delete(tree);
+  ts_tree_delete(expected);
+  ts_parser_delete(fresh);
+  return same;
+}
+
+static bool check_budget_abort(TSParser *parser, const char *path, const Text *source, PrpfmtParseBudget *budget,
+                               PrpfmtParseStatus expected, const char *name) {
+  PrpfmtParseStatus status;
+  TSTree *tree = prpfmt_parse_string(parser, NULL, source->data, source->length, budget, &status);
+  bool ok = true;
+  if (tree || status != expected) {
+    printf("FAIL budget %s: %s did not abort the parse\n", path, name);
+    ts_tree_delete(tree);
+    ok = false;
+  }
+  if (!parses_like_fresh(parser, source->data, source->length)) {
+    printf("FAIL budget %s: the parser was not reset after %s\n", path, name);
+    ok = false;
+  }
+  return ok;
+}
+
+static bool check_budget(TSParser *parser, const char *path, const char *source, uint32_t length) {
+  if (length == 0) {
+    return true;
+  }
+  uint32_t copies = BUDGET_MIN_BYTES / (length + 1) + 1;
+  Text repeated = {malloc((size_t)copies * (length + 1) + 1), copies * (length + 1)};
+  if (!repeated.data) {
+    fprintf(stderr, "Memory allocation failed");
+    exit(1);
+  }
+  for (uint32_t i = 0; i < copies; i++) {
+    memcpy(repeated.data + (size_t)i * (length + 1), source, length);
+    repeated.data[(size_t)i * (length + 1) + length] = '\n';
+  }
+  repeated.data[repeated.length] = '\0';
+
+  atomic_bool cancel = true;
+  PrpfmtParseBudget cancelled = {.cancel = &cancel};
+  prpfmt_budget_start(&cancelled);
+  bool ok = check_budget_abort(parser, path, &repeated, &cancelled, PRPFMT_PARSE_CANCELLED, "a set cancel flag");
+
+  // Start a 1 us budget and let it run out before parsing
+  PrpfmtParseBudget expired = {.timeout_micros = 1};
+  prpfmt_budget_start(&expired);
+  struct timespec pause = {0, 1000000};
+  nanosleep(&pause, NULL);
+  ok = check_budget_abort(parser, path, &repeated, &expired, PRPFMT_PARSE_TIMED_OUT, "an expired deadline") && ok;
+
+  free(repeated.data);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
+    print_help();
+    return argc < 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, tree_sitter_pyrope())) {
+    fprintf(stderr, "Error: the language was generated with an "
+                    "incompatible version of the tree-sitter CLI.\n");
+    return 1;
+  }
+  prpfmt_init(tree_sitter_pyrope());
+
+  int failures = !check_incremental(parser, "<nested directive>", NESTED_DIRECTIVE,
+                                    (uint32_t)strlen(NESTED_DIRECTIVE));
+  for (int i = 1; i < argc; i++) {
+    PrpfmtInput input;
+    int error = prpfmt_input_open(&input, argv[i]);
+    if (error) {
+      fprintf(stderr, "Error: %s: %s\n", argv[i], strerror(error));
+      failures++;
+      continue;
+    }
+    bool ok = check_incremental(parser, argv[i], input.data, input.length);
+    ok = check_flat(parser, argv[i], input.data, input.length) && ok;
+    ok = check_budget(parser, argv[i], input.data, input.length) && ok;
+    failures += !ok;
+    prpfmt_input_close(&input);
+  }
+
+  ts_parser_delete(parser);
+  printf("%d of %d files failed\n", failures, argc - 1);
+  return failures != 0;
+}
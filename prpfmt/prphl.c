@@ -0,0 +1,407 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <tree_sitter/api.h>
+#include <unistd.h>
+
+#include "prpfmt.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+// Batch syntax highlighter for .prp files on queries/highlights.scm, for
+// tools that highlight many files per process (code review, docs). One
+// parser and one query cursor are reused across all inputs.
+//
+// --format ansi (default) prints the sources with terminal colors.
+// --format spans writes a compact binary stream:
+//   header:   "PRPSPANS", u32 version (1), u32 capture count, then per
+//             capture a u16 name length and the name bytes
+//   per file: u32 path length, path bytes, u32 span count, then the spans
+//             as PrpfmtSpan records (u32 start, u32 end, u16 capture,
+//             u16 pattern), sorted as described in prpfmt.h
+// All integers are in host byte order.
+//
+// --bench highlights the inputs --iterations times and reports captures
+// per second (before overlapping spans are dropped) and MB/s, then the time
+// of each pattern compiled and run on its own.
+
+#define SPANS_MAGIC "PRPSPANS"
+#define SPANS_VERSION 1
+#define DEFAULT_ITERATIONS 10
+
+void print_help() {
+  printf("Usage: ./prphl [--format ansi|spans] [--bench] [--iterations <n>] <file_or_dir>...\n\n");
+  printf("Options:\n");
+  printf("  --format ansi     Print the sources with terminal colors (default).\n");
+  printf("  --format spans    Write highlight spans in the binary format described in prphl.c.\n");
+  printf("  --bench           Report captures/sec, MB/s and the time of each pattern alone instead of output.\n");
+  printf("  --iterations <n>  Timed highlight runs with --bench. Defaults to %d.\n", DEFAULT_ITERATIONS);
+}
+
+typedef struct {
+  char **paths;
+  size_t count;
+} PathList;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void collect(PathList *list, const char *path) {
+  struct stat sb;
+  if (stat(path, &sb) != 0) {
+    perror(path);
+    exit(1);
+  }
+  if (!S_ISDIR(sb.st_mode)) {
+    list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+    list->paths[list->count++] = strdup(path);
+    return;
+  }
+
+  DIR *d = opendir(path);
+  if (!d) {
+    perror(path);
+    exit(1);
+  }
+  size_t first = list->count;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    size_t len = strlen(entry->d_name);
+    if (len > 4 && strcmp(entry->d_name + len - 4, ".prp") == 0) {
+      size_t size = strlen(path) + len + 2;
+      char *file = malloc(size);
+      snprintf(file, size, "%s/%s", path, entry->d_name);
+      list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+      list->paths[list->count++] = file;
+    }
+  }
+  closedir(d);
+  qsort(list->paths + first, list->count - first, sizeof(char *), compare_strings);
+}
+
+// Terminal color of each capture, by the first component of its name
+static const char **capture_colors(const TSQuery *query) {
+  static const struct {
+    const char *name;
+    const char *color;
+  } colors[] = {
+    {"keyword", "\x1b[35m"},  {"conditional", "\x1b[35m"}, {"function", "\x1b[34m"}, {"type", "\x1b[33m"},
+    {"string", "\x1b[32m"},   {"number", "\x1b[36m"},      {"boolean", "\x1b[36m"},  {"comment", "\x1b[90m"},
+    {"parameter", "\x1b[3m"}, {"debug", "\x1b[31m"},
+  };
+  uint32_t capture_count = ts_query_capture_count(query);
+  const char **result = calloc(capture_count, sizeof(char *));
+  for (uint32_t c = 0; c < capture_count; c++) {
+    uint32_t length;
+    const char *name = ts_query_capture_name_for_id(query, c, &length);
+    const char *dot = memchr(name, '.', length);
+    if (dot) {
+      length = (uint32_t)(dot - name);
+    }
+    for (size_t i = 0; i < sizeof(colors) / sizeof(colors[0]); i++) {
+      if (strlen(colors[i].name) == length && memcmp(colors[i].name, name, length) == 0) {
+        result[c] = colors[i].color;
+      }
+    }
+  }
+  return result;
+}
+
+static void write_text(PrpfmtSink *out, const char *text, uint32_t length, const char *color) {
+  if (length == 0) {
+    return;
+  }
+  if (color) {
+    prpfmt_sink_write(out, color, strlen(color));
+    prpfmt_sink_write(out, text, length);
+    prpfmt_sink_write(out, "\x1b[0m", 4);
+  } else {
+    prpfmt_sink_write(out, text, length);
+  }
+}
+
+// Print source with the color of the innermost span at each byte
+static void write_ansi(PrpfmtSink *out, const PrpfmtHighlighter *hl, const PrpfmtInput *input,
+                       const char **colors) {
+  PrpfmtSpan stack[256];
+  uint32_t depth = 0;
+  uint32_t position = 0;
+  for (uint32_t i = 0; i <= hl->span_count; i++) {
+    uint32_t start = i < hl->span_count ? hl->spans[i].start_byte : input->length;
+    while (depth > 0 && stack[depth - 1].end_byte <= start) {
+      PrpfmtSpan *top = &stack[--depth];
+      if (top->end_byte > position) {
+        write_text(out, input->data + position, top->end_byte - position, colors[top->capture]);
+        position = top->end_byte;
+      }
+    }
+    if (start > position) {
+      write_text(out, input->data + position, start - position, depth ? colors[stack[depth - 1].capture] : NULL);
+      position = start;
+    }
+    if (i == hl->span_count || depth == sizeof(stack) / sizeof(stack[0])) {
+      continue;
+    }
+    stack[depth] = hl->spans[i];
+    if (depth > 0 && stack[depth].end_byte > stack[depth - 1].end_byte) {
+      stack[depth].end_byte = stack[depth - 1].end_byte;
+    }
+    depth++;
+  }
+}
+
+static void write_u32(PrpfmtSink *out, uint32_t value) {
+  prpfmt_sink_write(out, (const char *)&value, sizeof(value));
+}
+
+static void write_spans_header(PrpfmtSink *out, const TSQuery *query) {
+  prpfmt_sink_write(out, SPANS_MAGIC, 8);
+  write_u32(out, SPANS_VERSION);
+  uint32_t capture_count = ts_query_capture_count(query);
+  write_u32(out, capture_count);
+  for (uint32_t c = 0; c < capture_count; c++) {
+    uint32_t length;
+    const char *name = ts_query_capture_name_for_id(query, c, &length);
+    uint16_t name_length = (uint16_t)length;
+    prpfmt_sink_write(out, (const char *)&name_length, sizeof(name_length));
+    prpfmt_sink_write(out, name, name_length);
+  }
+}
+
+static void write_spans(PrpfmtSink *out, const PrpfmtHighlighter *hl, const char *path) {
+  write_u32(out, (uint32_t)strlen(path));
+  prpfmt_sink_write(out, path, strlen(path));
+  write_u32(out, hl->span_count);
+  prpfmt_sink_write(out, (const char *)hl->spans, hl->span_count * sizeof(PrpfmtSpan));
+}
+
+typedef struct {
+  uint32_t pattern;
+  double seconds;
+} PatternTime;
+
+static int compare_pattern_times(const void *a, const void *b) {
+  double x = ((const PatternTime *)a)->seconds;
+  double y = ((const PatternTime *)b)->seconds;
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Highlight every tree iterations times; returns the seconds per iteration
+// and the captures and spans of one
+static double highlight_all(PrpfmtHighlighter *hl, TSTree **trees, PrpfmtInput *inputs, size_t count,
+                            int iterations, uint64_t *captures, uint64_t *spans) {
+  *captures = 0;
+  *spans = 0;
+  double start = now_seconds();
+  for (int r = 0; r < iterations; r++) {
+    for (size_t i = 0; i < count; i++) {
+      if (!prpfmt_highlight(hl, trees[i], inputs[i].data)) {
+        fprintf(stderr, "Memory allocation failed");
+        exit(1);
+      }
+      if (r == 0) {
+        *captures += hl->capture_count;
+        *spans += hl->span_count;
+      }
+    }
+  }
+  return (now_seconds() - start) / iterations;
+}
+
+// Highlight the parsed inputs iterations times, then time each pattern
+// compiled and run alone, as bench/query_profile.c does. With all patterns
+// in one query the cursor's work is shared and cannot be split by pattern.
+static void run_bench(PrpfmtHighlighter *hl, TSTree **trees, PrpfmtInput *inputs, size_t count, int iterations,
+                      double parse_seconds) {
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < count; i++) {
+    bytes += inputs[i].length;
+  }
+
+  uint64_t captures, spans;
+  double seconds = highlight_all(hl, trees, inputs, count, iterations, &captures, &spans);
+  printf("%zu files, %llu bytes, %llu captures, %llu spans\n", count, (unsigned long long)bytes,
+         (unsigned long long)captures, (unsigned long long)spans);
+  printf("parse:     %8.3f ms  %8.2f MB/s\n", parse_seconds * 1e3, (double)bytes / 1e6 / parse_seconds);
+  printf("highlight: %8.3f ms  %8.2f MB/s  %.0f captures/s\n\n", seconds * 1e3, (double)bytes / 1e6 / seconds,
+         (double)captures / seconds);
+
+  uint32_t query_length;
+  const char *query_source = prpfmt_query_source(PRPFMT_QUERY_HIGHLIGHTS, &query_length);
+  uint32_t pattern_count = ts_query_pattern_count(hl->query);
+  PatternTime *times = malloc(pattern_count * sizeof(PatternTime));
+  double total = 0;
+  for (uint32_t p = 0; p < pattern_count; p++) {
+    uint32_t start = ts_query_start_byte_for_pattern(hl->query, p);
+    uint32_t end = ts_query_end_byte_for_pattern(hl->query, p);
+    uint32_t error_offset;
+    TSQueryError error;
+    TSQuery *single = ts_query_new(tree_sitter_pyrope(), query_source + start, end - start, &error_offset, &error);
+    PrpfmtHighlighter alone;
+    times[p] = (PatternTime){.pattern = p, .seconds = -1};
+    if (single && prpfmt_highlighter_init_query(&alone, single)) {
+      times[p].seconds = highlight_all(&alone, trees, inputs, count, iterations, &captures, &spans);
+      total += times[p].seconds;
+      prpfmt_highlighter_destroy(&alone);
+    }
+    if (single) {
+      ts_query_delete(single);
+    }
+  }
+  qsort(times, pattern_count, sizeof(PatternTime), compare_pattern_times);
+
+  // Each pattern alone walks the whole tree, so the times add up to more
+  // than the highlight time above; share is of their sum
+  printf("%7s %10s %7s  %s\n", "line", "ms alone", "share", "pattern");
+  for (uint32_t i = 0; i < pattern_count; i++) {
+    uint32_t pattern_start = ts_query_start_byte_for_pattern(hl->query, times[i].pattern);
+    unsigned line = 1;
+    for (uint32_t b = 0; b < pattern_start; b++) {
+      line += query_source[b] == '\n';
+    }
+    uint32_t end = pattern_start;
+    while (end < query_length && query_source[end] != '\n' && end - pattern_start < 50) {
+      end++;
+    }
+    if (times[i].seconds < 0) {
+      printf("%7u %10s %7s  %.*s (does not compile alone)\n", line, "-", "-", (int)(end - pattern_start),
+             query_source + pattern_start);
+      continue;
+    }
+    printf("%7u %10.3f %6.1f%%  %.*s\n", line, times[i].seconds * 1e3,
+           total > 0 ? 100.0 * times[i].seconds / total : 0.0, (int)(end - pattern_start),
+           query_source + pattern_start);
+  }
+  free(times);
+}
+
+int main(int argc, char **argv) {
+  bool spans = false;
+  bool bench = false;
+  int iterations = DEFAULT_ITERATIONS;
+  PathList paths = {0};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      print_help();
+      return 0;
+    } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "spans") == 0) {
+        spans = true;
+      } else if (strcmp(argv[i], "ansi") != 0) {
+        fprintf(stderr, "Error: unknown format '%s'.\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--bench") == 0) {
+      bench = true;
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Error: Invalid argument '%s'.\n", argv[i]);
+      print_help();
+      return 1;
+    } else {
+      collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0 || iterations < 1) {
+    print_help();
+    return 1;
+  }
+
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, tree_sitter_pyrope())) {
+    fprintf(stderr, "Error: the language was generated with an "
+                    "incompatible version of the tree-sitter CLI.\n");
+    return 1;
+  }
+  PrpfmtHighlighter hl;
+  if (!prpfmt_highlighter_init(&hl)) {
+    uint32_t offset;
+    prpfmt_query_error(PRPFMT_QUERY_HIGHLIGHTS, &offset);
+    fprintf(stderr, "Error: highlights.scm does not compile (byte %u); see prpquery --check-queries.\n", offset);
+    return 1;
+  }
+
+  // --bench keeps every tree to highlight them again; output modes
+  // highlight each file as it is parsed
+  PrpfmtInput *inputs = calloc(paths.count, sizeof(PrpfmtInput));
+  TSTree **trees = calloc(paths.count, sizeof(TSTree *));
+  PrpfmtSink out;
+  prpfmt_sink_init_fd(&out, STDOUT_FILENO);
+  const char **colors = spans ? NULL : capture_colors(hl.query);
+  if (spans && !bench) {
+    write_spans_header(&out, hl.query);
+  }
+
+  int status = 0;
+  size_t count = 0;
+  double parse_seconds = 0;
+  for (size_t i = 0; i < paths.count; i++) {
+    int error = prpfmt_input_open(&inputs[count], paths.paths[i]);
+    if (error) {
+      fprintf(stderr, "Error: %s: %s\n", paths.paths[i], strerror(error));
+      status = 1;
+      continue;
+    }
+    double start = now_seconds();
+    TSTree *tree = ts_parser_parse_string(parser, NULL, inputs[count].data, inputs[count].length);
+    parse_seconds += now_seconds() - start;
+    if (bench) {
+      trees[count++] = tree;
+      continue;
+    }
+
+    if (!prpfmt_highlight(&hl, tree, inputs[count].data)) {
+      fprintf(stderr, "Memory allocation failed");
+      exit(1);
+    }
+    if (spans) {
+      write_spans(&out, &hl, paths.paths[i]);
+    } else {
+      if (paths.count > 1) {
+        char header[4096];
+        int length = snprintf(header, sizeof(header), "==> %s <==\n", paths.paths[i]);
+        prpfmt_sink_write(&out, header, (size_t)length < sizeof(header) ? (size_t)length : sizeof(header) - 1);
+      }
+      write_ansi(&out, &hl, &inputs[count], colors);
+    }
+    ts_tree_delete(tree);
+    prpfmt_input_close(&inputs[count]);
+  }
+
+  if (bench && count > 0) {
+    run_bench(&hl, trees, inputs, count, iterations, parse_seconds);
+  }
+  if (!prpfmt_sink_destroy(&out)) {
+    fprintf(stderr, "Error: failed to write output.\n");
+    status = 1;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    ts_tree_delete(trees[i]);
+    prpfmt_input_close(&inputs[i]);
+  }
+  for (size_t i = 0; i < paths.count; i++) {
+    free(paths.paths[i]);
+  }
+  free(paths.paths);
+  free(inputs);
+  free(trees);
+  free(colors);
+  prpfmt_highlighter_destroy(&hl);
+  ts_parser_delete(parser);
+  return status;
+}
@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <tree_sitter/api.h>
+
+#include "prpfmt.h"
+
+const TSLanguage *tree_sitter_pyrope(void);
+
+// Lint-style node queries over .prp files. A pattern is a node type, which
+// matches every named node of that type, or <parent_type>.<field>, which
+// matches the children of <parent_type> nodes held in <field> ("*" matches
+// any parent). Queries run on the parse cache node table, so with --cache
+// unchanged files are not parsed again.
+
+void print_help() {
+  printf("Usage: ./prpquery [--cache <dir>] [--count] <pattern> <file_or_dir>...\n");
+  printf("       ./prpquery --check-queries\n\n");
+  printf("Patterns:\n");
+  printf("  <type>            Named nodes of <type>, e.g. function_definition.\n");
+  printf("  <type>.<field>    Children in <field> of <type> nodes, e.g. assignment.lvalue or *.type.\n\n");
+  printf("Options:\n");
+  printf("  --cache <dir>     Load and store parse results in <dir>.\n");
+  printf("  --count           Print the number of matches per file instead of the matches.\n");
+  printf("  --check-queries   Compile the built-in highlights, folds and indents queries and report errors.\n");
+}
+
+typedef struct {
+  bool *types;      // by symbol: node types to match, or parent types with a field
+  TSFieldId field;  // 0 when the pattern has no field
+} Pattern;
+
+typedef struct {
+  char **paths;
+  size_t count;
+} PathList;
+
+static bool compile_pattern(const TSLanguage *language, const char *text, Pattern *pattern) {
+  uint32_t symbol_count = ts_language_symbol_count(language);
+  pattern->types = calloc(symbol_count, sizeof(bool));
+  pattern->field = 0;
+
+  size_t type_length = strlen(text);
+  const char *dot = strchr(text, '.');
+  if (dot) {
+    type_length = (size_t)(dot - text);
+    pattern->field = ts_language_field_id_for_name(language, dot + 1, (uint32_t)strlen(dot + 1));
+    if (pattern->field == 0) {
+      fprintf(stderr, "Error: unknown field '%s'.\n", dot + 1);
+      return false;
+    }
+  }
+
+  bool any = dot && type_length == 1 && text[0] == '*';
+  bool found = false;
+  for (TSSymbol symbol = 0; symbol < symbol_count; symbol++) {
+    const char *name = ts_language_symbol_name(language, symbol);
+    if (ts_language_symbol_type(language, symbol) == TSSymbolTypeRegular &&
+        (any || (strlen(name) == type_length && strncmp(name, text, type_length) == 0))) {
+      pattern->types[symbol] = true;
+      found = true;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "Error: unknown node type '%.*s'.\n", (int)type_length, text);
+  }
+  return found;
+}
+
+static bool pattern_matches(const Pattern *pattern, const PrpfmtCacheEntry *entry, uint32_t index) {
+  const PrpfmtCacheNode *node = &entry->nodes[index];
+  if (pattern->field == 0) {
+    return (node->flags & PRPFMT_CACHE_NAMED) && pattern->types[node->symbol];
+  }
+  return node->field_id == pattern->field && node->parent != PRPFMT_CACHE_NONE &&
+         pattern->types[entry->nodes[node->parent].symbol];
+}
+
+// Print path:line:column: and the first line of each match. Nodes are in
+// pre-order, so their start bytes never decrease and lines are counted in
+// one pass over the source.
+static size_t run_query(const char *path, const Pattern *pattern, const PrpfmtCacheEntry *entry,
+                        const PrpfmtInput *input, bool count_only) {
+  size_t matches = 0;
+  uint32_t line = 1;
+  uint32_t line_start = 0;
+  uint32_t position = 0;
+  for (uint32_t i = 0; i < entry->node_count; i++) {
+    if (!pattern_matches(pattern, entry, i)) {
+      continue;
+    }
+    matches++;
+    if (count_only) {
+      continue;
+    }
+
+    uint32_t start = entry->nodes[i].start_byte;
+    for (; position < start && position < input->length; position++) {
+      if (input->data[position] == '\n') {
+        line++;
+        line_start = position + 1;
+      }
+    }
+    uint32_t end = start;
+    while (end < entry->nodes[i].end_byte && end < input->length && input->data[end] != '\n' && end - start < 80) {
+      end++;
+    }
+    printf("%s:%u:%u: %.*s\n", path, line, start - line_start + 1, (int)(end - start), input->data + start);
+  }
+  if (count_only) {
+    printf("%s: %zu\n", path, matches);
+  }
+  return matches;
+}
+
+// Compile every query of the registry and print its size or the line and
+// column where ts_query_new rejected it
+static int check_queries(void) {
+  static const char *const errors[] = {"none", "syntax", "node type", "field", "capture", "structure", "language"};
+  int status = 0;
+  for (PrpfmtQueryKind kind = 0; kind < PRPFMT_QUERY_COUNT; kind++) {
+    const TSQuery *query = prpfmt_query(kind);
+    if (query) {
+      printf("%s: %u patterns, %u captures\n", prpfmt_query_name(kind), ts_query_pattern_count(query),
+             ts_query_capture_count(query));
+      continue;
+    }
+    uint32_t offset;
+    TSQueryError error = prpfmt_query_error(kind, &offset);
+    printf("%s.scm: byte %u: %s error\n", prpfmt_query_name(kind), offset,
+           error < sizeof(errors) / sizeof(errors[0]) ? errors[error] : "unknown");
+    status = 1;
+  }
+  return status;
+}
+
+static int compare_strings(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void collect(PathList *list, const char *path) {
+  struct stat sb;
+  if (stat(path, &sb) != 0) {
+    perror(path);
+    exit(1);
+  }
+  if (!S_ISDIR(sb.st_mode)) {
+    list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+    list->paths[list->count++] = strdup(path);
+    return;
+  }
+
+  DIR *d = opendir(path);
+  if (!d) {
+    perror(path);
+    exit(1);
+  }
+  size_t first = list->count;
+  struct dirent *entry;
+  while ((entry = readdir(d))) {
+    size_t len = strlen(entry->d_name);
+    if (len > 4 && strcmp(entry->d_name + len - 4, ".prp") == 0) {
+      size_t size = strlen(path) + len + 2;
+      char *file = malloc(size);
+      snprintf(file, size, "%s/%s", path, entry->d_name);
+      list->paths = realloc(list->paths, (list->count + 1) * sizeof(char *));
+      list->paths[list->count++] = file;
+    }
+  }
+  closedir(d);
+  qsort(list->paths + first, list->count - first, sizeof(char *), compare_strings);
+}
+
+int main(int argc, char **argv) {
+  const char *cache_dir = NULL;
+  const char *pattern_text = NULL;
+  bool count_only = false;
+  PathList inputs = {0};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      print_help();
+      return 0;
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+      cache_dir = argv[++i];
+    } else if (strcmp(argv[i], "--count") == 0) {
+      count_only = true;
+    } else if (strcmp(argv[i], "--check-queries") == 0) {
+      return check_queries();
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Error: Invalid argument '%s'.\n", argv[i]);
+      print_help();
+      return 1;
+    } else if (!pattern_text) {
+      pattern_text = argv[i];
+    } else {
+      collect(&inputs, argv[i]);
+    }
+  }
+  if (!pattern_text || inputs.count == 0) {
+    print_help();
+    return 1;
+  }
+
+  const TSLanguage *language = tree_sitter_pyrope();
+  TSParser *parser = ts_parser_new();
+  if (!ts_parser_set_language(parser, language)) {
+    fprintf(stderr, "Error: the language was generated with an "
+                    "incompatible version of the tree-sitter CLI.\n");
+    return 1;
+  }
+  Pattern pattern;
+  if (!compile_pattern(language, pattern_text, &pattern)) {
+    return 1;
+  }
+
+  int status = 0;
+  size_t matches = 0;
+  size_t cached = 0;
+  for (size_t i = 0; i < inputs.count; i++) {
+    PrpfmtInput input;
+    int error = prpfmt_input_open(&input, inputs.paths[i]);
+    if (error) {
+      fprintf(stderr, "Error: %s: %s\n", inputs.paths[i], strerror(error));
+      status = 1;
+      free(inputs.paths[i]);
+      continue;
+    }
+
+    PrpfmtCacheEntry entry;
+    if (cache_dir && prpfmt_cache_load(cache_dir, language, input.data, input.length, &entry)) {
+      cached++;
+    } else {
+      TSTree *tree = ts_parser_parse_string(parser, NULL, input.data, input.length);
+      bool built = prpfmt_cache_build(tree, &entry);
+      ts_tree_delete(tree);
+      ts_parser_reset(parser);
+      if (!built) {
+        fprintf(stderr, "Memory allocation failed");
+        exit(1);
+      }
+      if (cache_dir) {
+        prpfmt_cache_store(cache_dir, language, input.data, input.length, &entry);
+      }
+    }
+
+    matches += run_query(inputs.paths[i], &pattern, &entry, &input, count_only);
+    prpfmt_cache_close(&entry);
+    prpfmt_input_close(&input);
+    free(inputs.paths[i]);
+  }
+  fprintf(stderr, "%zu files (%zu from cache), %zu matches\n", inputs.count, cached, matches);
+
+  free(inputs.paths);
+  free(pattern.types);
+  ts_parser_delete(parser);
+  return status;
+}
@@ -1,11 +1,11 @@
 [
- (function_call)
- (if_statement)
+ (function_call_expression)
+ (if_expression)
  (for_statement)
  (while_statement)
  (control_statement)
  (function_call_statement)
  (assignment_or_declaration_statement)
- (enum_declaration)
+ (enum_definition)
 ] @fold
 
@@ -7,69 +7,47 @@
 
 (expression_type) @type
 
-(function_type) @type
+(function_call_type
+  function: (complex_identifier (identifier) @type))
 
 ; Parameters 
-(function_call
+(function_call_expression
   argument: (tuple
     (tuple_list
       item: (complex_identifier (identifier) @parameter))))
 
-(simple_function_call
+(function_call_statement
   argument: (expression_list
     item: (complex_identifier (identifier) @parameter)))
 
-(function_definition
+(function_definition_decl
   input: (arg_list
-    (arg_item_list (arg_item (complex_identifier (identifier) @parameter)))))
+    (arg_item_list (arg_item (typed_identifier identifier: (identifier) @parameter)))))
 
 ; Attributes
 
-(attributes
-  (tuple_sq (tuple_list
-    item: (complex_identifier (identifier) @function.macro))))
+(attribute_item
+  name: (identifier) @function.macro)
 
-(attributes
-  (tuple (tuple_list
-    item: (complex_identifier (identifier) @function.macro))))
-
-(attributes
-  (tuple_sq (tuple_list
-    item: (ref_identifier (complex_identifier (identifier) @function.macro)))))
-
-(attributes
-  (tuple (tuple_list
-    item: (ref_identifier (complex_identifier (identifier) @function.macro)))))
-
-(dot_expression
-  (tuple_sq (tuple_list
-    item: (complex_identifier (identifier) @function.macro))))
-
-(dot_expression
-  (tuple_sq (tuple_list
-    item: (ref_identifier (complex_identifier (identifier) @function.macro)))))
 ; Function calls
 
-(simple_function_call
+(function_call_statement
   function: (complex_identifier (identifier) @function.call))
 
-(function_call
+(function_call_expression
   function: (complex_identifier (identifier) @function.call))
 
-(function_inline
-  fun_name: (identifier) @function.call)
-
 ; Function definitions 
 
-(function_definition_statement
-  lvalue: (complex_identifier) @function)
+(lambda
+  name: (identifier) @function)
 
-(assignment_or_declaration_statement
+(assignment
   lvalue: (complex_identifier) @function
   rvalue: (lambda))
 
-(simple_assignment
-  lvalue: (identifier) @function
+(assignment
+  lvalue: (typed_identifier identifier: (identifier) @function)
   rvalue: (lambda))
 
 ; Fields
@@ -132,14 +110,15 @@
 [
   "in"
   "enum"
-  "var"
-  "let"
+  "const"
+  "mut"
 ] @keyword
 
 (test_statement "test" @keyword)
 
-(fun_tok) @keyword.function
-(proc_tok) @keyword.function
+(comb_tok) @keyword.function
+(pipe_tok) @keyword.function
+(flow_tok) @keyword.function
 
 [
   "if"
@@ -161,8 +140,6 @@
 
 ["," "." ":"] @punctuation.delimiter
 
-(pipestage_scope_statement "#>" @punctuation.special)
-
 ; Distinguish strings from numbers and booleans
 (constant) @number
 
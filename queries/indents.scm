@@ -1,7 +1,7 @@
 [
-  (function_definition)
-  (type_declaration)
-  (enum_declaration)
+  (lambda)
+  (type_statement)
+  (enum_definition)
   (expression_list)
   (tuple_list)
 ] @indent
@@ -19,9 +19,22 @@ void tree_sitter_pyrope_external_scanner_deserialize(void *p, const char *b,
 
 static void advance(TSLexer *lexer) { lexer->advance(lexer, false); }
 
+// iswspace is locale-aware and costly per character; ASCII, which is nearly
+// all of the input, is classified with a table instead.
+static const bool ascii_space[128] = {
+    ['\t'] = true, ['\n'] = true, ['\v'] = true,
+    ['\f'] = true, ['\r'] = true, [' '] = true,
+};
+
+static inline bool is_space(int32_t c) {
+  if (c >= 0 && c < 128)
+    return ascii_space[c];
+  return iswspace(c);
+}
+
 static bool scan_whitespace_and_comments(TSLexer *lexer) {
   for (;;) {
-    while (iswspace(lexer->lookahead)) {
+    while (is_space(lexer->lookahead)) {
       advance(lexer);
     }
 
@@ -73,7 +86,7 @@ bool tree_sitter_pyrope_external_scanner_scan(void *payload, TSLexer *lexer,
 
     if (lexer->is_at_included_range_start(lexer))
       return true;
-    if (!iswspace(lexer->lookahead))
+    if (!is_space(lexer->lookahead))
       return false;
     if (lexer->lookahead == '\n')
       break;
@@ -82,6 +95,10 @@ bool tree_sitter_pyrope_external_scanner_scan(void *payload, TSLexer *lexer,
 
   advance(lexer);
 
+  // The comments after this newline are scanned again from each newline
+  // between them, so a run of n comment lines before a continuation line
+  // costs O(n^2). The scanner keeps no state, and a cache would have to be
+  // serialized for incremental parsing, so this is left as it is.
   scan_whitespace_and_comments(lexer);
 
   switch (lexer->lookahead) {
@@ -3,3 +3,125 @@
 for a in full_pyrope/*.prp; do
 	./node_modules/tree-sitter-cli/tree-sitter parse -q $a
 done
+
+# Node types, tokens and fields used by queries/*.scm
+python3 bench/check_queries.py || exit 1
+
+# prpfmt's printer dispatch table and symbol enum against the generated parser
+python3 prpfmt/gen_dispatch.py --check || exit 1
+
+# Parser throughput regression gate. Needs the tree-sitter runtime to build
+# prpbench (see bench.sh) and a baseline from the reference machine
+# (perf_gate.py --update); skipped otherwise. Run perf_gate.py directly to
+# make a missing baseline an error.
+cmake -S . -B build -DCMAKE_BUILD_TYPE=Release >/dev/null
+if [ ! -f bench/perf_baseline.json ]; then
+	echo "bench/perf_baseline.json missing; skipping throughput gate (create it with perf_gate.py --update)"
+elif cmake --build build --target prpbench -j"$(nproc)" >/dev/null 2>&1; then
+	./build/prpfmt/prpbench --iterations 7 --scales 1,8 --json build/perf_gate.json \
+		full_pyrope old_pyrope_snippets || exit 1
+	python3 bench/perf_gate.py build/perf_gate.json || exit 1
+else
+	echo "prpbench not built (tree-sitter runtime missing); skipping throughput gate"
+fi
+
+# Parse budget: aborts are checked deterministically by prpfmt_test (budget)
+# below; here a generous --timeout must not change prpfmt's output
+if [ -x build/prpfmt/prpfmt ] || cmake --build build --target prpfmt -j"$(nproc)" >/dev/null 2>&1; then
+	for a in full_pyrope/*.prp; do
+		./build/prpfmt/prpfmt "$a" >build/budget_plain.out 2>/dev/null || continue
+		./build/prpfmt/prpfmt --timeout 60000 "$a" | cmp -s - build/budget_plain.out || {
+			echo "prpfmt --timeout changed the output of $a"
+			exit 1
+		}
+	done
+fi
+
+# Replay the fuzz seeds: hand-written stress inputs (deep nesting, long
+# chains, unclosed blocks) that must stay within the fuzz limits
+if cmake --build build --target fuzz_parse fuzz_format -j"$(nproc)" >/dev/null 2>&1; then
+	./build/fuzz/fuzz_parse fuzz/seeds 2>/dev/null || exit 1
+	./build/fuzz/fuzz_format fuzz/seeds 2>/dev/null || exit 1
+fi
+
+# Deep nesting: a 100k-operand chain is formatted without recursion, and
+# 100k nested parentheses are copied as written past PRPFMT_MAX_NESTING
+if [ -x build/prpfmt/prpfmt ]; then
+	awk 'BEGIN { printf "const a = x0"; for (i = 1; i < 100000; i++) printf " + x%d", i; print "" }' >build/deep_chain.prp
+	./build/prpfmt/prpfmt build/deep_chain.prp | cmp -s - build/deep_chain.prp || {
+		echo "prpfmt failed on a 100k-deep binary chain"
+		exit 1
+	}
+	awk 'BEGIN { printf "const a = "; for (i = 0; i < 100000; i++) printf "("; printf "1"; for (i = 0; i < 100000; i++) printf ")"; print "" }' >build/deep_parens.prp
+	./build/prpfmt/prpfmt build/deep_parens.prp | cmp -s - build/deep_parens.prp || {
+		echo "prpfmt failed on 100k nested parentheses"
+		exit 1
+	}
+fi
+
+# Library checks: incremental re-formatting against a full reformat, the
+# flat tree export against a cursor walk and through a file round trip, and
+# parse budget aborts and parser reset
+if cmake --build build --target prpfmt_test -j"$(nproc)" >/dev/null 2>&1; then
+	./build/prpfmt/prpfmt_test full_pyrope/*.prp || exit 1
+fi
+
+# --stream must print what normal mode prints, per file and for the corpus
+# concatenated into one input large enough to be cut into many windows
+if [ -x build/prpfmt/prpfmt ]; then
+	: >build/stream_corpus.prp
+	for a in full_pyrope/*.prp; do
+		./build/prpfmt/prpfmt "$a" >build/stream_normal.out 2>/dev/null || continue
+		./build/prpfmt/prpfmt --stream "$a" | cmp -s - build/stream_normal.out || {
+			echo "prpfmt --stream differs from normal mode on $a"
+			exit 1
+		}
+		{ cat "$a"; echo; } >>build/stream_corpus.prp
+	done
+	for i in 1 2 3; do
+		cat build/stream_corpus.prp build/stream_corpus.prp >build/stream_corpus.tmp
+		mv build/stream_corpus.tmp build/stream_corpus.prp
+	done
+	if ./build/prpfmt/prpfmt build/stream_corpus.prp >build/stream_normal.out; then
+		./build/prpfmt/prpfmt --stream build/stream_corpus.prp | cmp -s - build/stream_normal.out || {
+			echo "prpfmt --stream differs from normal mode on the concatenated corpus"
+			exit 1
+		}
+	fi
+fi
+
+# Parse cache: a warm run prints what a cold run printed, an edited file
+# misses, and prpquery answers the same from a cold and a warm cache
+if [ -x build/prpfmt/prpfmt ] && cmake --build build --target prpquery -j"$(nproc)" >/dev/null 2>&1; then
+	cache=build/test_cache
+	rm -rf "$cache"
+	for a in full_pyrope/*.prp; do
+		./build/prpfmt/prpfmt --cache "$cache" "$a" >build/cache_cold.out 2>/dev/null || continue
+		./build/prpfmt/prpfmt --cache "$cache" "$a" | cmp -s - build/cache_cold.out || {
+			echo "prpfmt --cache output differs between a cold and a warm cache on $a"
+			exit 1
+		}
+	done
+	edited=build/cache_edited.prp
+	cp full_pyrope/$(ls full_pyrope | head -n 1) "$edited"
+	./build/prpfmt/prpfmt --cache "$cache" "$edited" >/dev/null 2>&1
+	entries=$(ls "$cache" | wc -l)
+	echo "// edited" >>"$edited"
+	./build/prpfmt/prpfmt --cache "$cache" "$edited" >/dev/null 2>&1
+	[ "$(ls "$cache" | wc -l)" -gt "$entries" ] || {
+		echo "prpfmt --cache reused the entry of an edited file"
+		exit 1
+	}
+
+	rm -rf "$cache"
+	./build/prpfmt/prpquery --cache "$cache" assignment full_pyrope >build/query_cold.out 2>build/query_cold.err || exit 1
+	./build/prpfmt/prpquery --cache "$cache" assignment full_pyrope >build/query_warm.out 2>build/query_warm.err || exit 1
+	cmp -s build/query_cold.out build/query_warm.out || {
+		echo "prpquery output differs between a cold and a warm cache"
+		exit 1
+	}
+	grep -q "(0 from cache)" build/query_cold.err && grep -q '^\([0-9]*\) files (\1 from cache)' build/query_warm.err || {
+		echo "prpquery did not load the warm cache"
+		exit 1
+	}
+fi